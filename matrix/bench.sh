@@ -0,0 +1,11 @@
+#!/bin/bash
+
+set -e
+
+for bench in bench/*.cpp; do
+    name=$(basename "$bench" .cpp)
+    g++ -std=c++17 -O2 -DNDEBUG -I./ "$bench" src/*.cpp -pthread -o "bench_$name"
+    echo "== $name"
+    "./bench_$name"
+    rm "bench_$name"
+done
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "bench/bench_util.h"
+#include "src/accumulation.h"
+#include "src/basic_matrix.h"
+
+
+using task::Accumulation;
+using task::Matrix;
+
+
+const char* Name(Accumulation policy) {
+    switch (policy) {
+        case Accumulation::Plain:
+            return "plain";
+        case Accumulation::Widened:
+            return "widened";
+        case Accumulation::Kahan:
+            return "kahan";
+        default:
+            return "pairwise";
+    }
+}
+
+// Product in long double, the reference for the error columns.
+std::vector<long double> Reference(const Matrix& a, const Matrix& b) {
+    std::vector<long double> result(a.rows() * b.cols(), 0);
+    for (std::size_t i = 0; i < a.rows(); ++i) {
+        for (std::size_t p = 0; p < a.cols(); ++p) {
+            long double factor = a.get(i, p);
+            for (std::size_t j = 0; j < b.cols(); ++j) {
+                result[i * b.cols() + j] += factor * b.get(p, j);
+            }
+        }
+    }
+    return result;
+}
+
+// Largest difference relative to the largest reference element.
+template <class Get>
+double RelativeError(const std::vector<long double>& expected, std::size_t cols, Get get) {
+    long double error = 0, scale = 0;
+    for (std::size_t e = 0; e < expected.size(); ++e) {
+        error = std::max(error, std::fabs(get(e / cols, e % cols) - expected[e]));
+        scale = std::max(scale, std::fabs(expected[e]));
+    }
+    return double(error / scale);
+}
+
+
+int main() {
+    const Accumulation policies[] = {Accumulation::Plain, Accumulation::Widened, Accumulation::Kahan,
+                                     Accumulation::Pairwise};
+    std::printf("64 x k times k x 64\n");
+    std::printf("%8s %10s %12s %10s %12s %12s %10s %12s\n", "k", "policy", "double ms", "GFLOP/s",
+                "rel. error", "float ms", "GFLOP/s", "rel. error");
+    for (std::size_t k : {1024, 8192, 65536}) {
+        Matrix a = RandomMatrix(64, k);
+        Matrix b = RandomMatrix(k, 64);
+        task::MatrixF float_a(a), float_b(b);
+        std::vector<long double> expected = Reference(a, b);
+        std::vector<long double> float_expected = Reference(float_a.to_matrix(), float_b.to_matrix());
+        double flops = 2. * 64 * 64 * k;
+        for (Accumulation policy : policies) {
+            task::set_accumulation(policy);
+            Matrix product = a * b;
+            double time = BestTime([&] {
+                Matrix result = a * b;
+                DoNotOptimize(result);
+            });
+            task::MatrixF float_product = float_a * float_b;
+            double float_time = BestTime([&] {
+                task::MatrixF result = float_a * float_b;
+                DoNotOptimize(result);
+            });
+            std::printf("%8zu %10s %12.2f %10.2f %12.2e %12.2f %10.2f %12.2e\n", k, Name(policy),
+                        time * 1e3, flops / time * 1e-9,
+                        RelativeError(expected, 64, [&](std::size_t i, std::size_t j) {
+                            return (long double)product.get(i, j);
+                        }),
+                        float_time * 1e3, flops / float_time * 1e-9,
+                        RelativeError(float_expected, 64, [&](std::size_t i, std::size_t j) {
+                            return (long double)float_product(i, j);
+                        }));
+        }
+    }
+    task::set_accumulation(Accumulation::Plain);
+
+    std::printf("\ntrace of n x n\n");
+    std::printf("%8s %10s %12s %12s\n", "n", "policy", "us", "rel. error");
+    for (std::size_t n : {256, 4096}) {
+        Matrix a = RandomMatrix(n, n);
+        long double expected = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            expected += a.get(i, i);
+        }
+        for (Accumulation policy : policies) {
+            task::set_accumulation(policy);
+            double trace = a.trace();
+            double time = BestTime([&] {
+                double result = a.trace();
+                DoNotOptimize(result);
+            });
+            std::printf("%8zu %10s %12.2f %12.2e\n", n, Name(policy), time * 1e6,
+                        double(std::fabs(trace - expected) / std::fabs(expected)));
+        }
+    }
+    task::set_accumulation(Accumulation::Plain);
+}
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+
+
+using task::Matrix;
+
+
+int main() {
+    std::printf("%6s %14s %14s %14s %14s\n", "n", "heap us", "pooled us", "identity us", "uninit us");
+    for (std::size_t n : {4, 16, 64, 256, 1024}) {
+        Matrix a = RandomMatrix(n, n);
+
+        // A temporary copy per run; trimming the pool afterwards sends every
+        // buffer back to the heap, as without the pool.
+        double heap = BestTime([&] {
+            {
+                Matrix copy = a;
+                DoNotOptimize(copy);
+            }
+            task::trim_buffer_pool();
+        });
+        double pooled = BestTime([&] {
+            Matrix copy = a;
+            DoNotOptimize(copy);
+        });
+        double identity = BestTime([&] {
+            Matrix fresh(n, n);
+            DoNotOptimize(fresh);
+        });
+        double uninitialized = BestTime([&] {
+            Matrix fresh(n, n, task::UNINITIALIZED);
+            DoNotOptimize(fresh);
+        });
+
+        std::printf("%6zu %14.3f %14.3f %14.3f %14.3f\n", n, heap * 1e6, pooled * 1e6,
+                    identity * 1e6, uninitialized * 1e6);
+    }
+}
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <vector>
+#include "bench/bench_util.h"
+#include "src/matrix_batch.h"
+#include "src/simd.h"
+
+
+using task::Matrix;
+using task::MatrixBatch;
+
+
+int main() {
+    const std::size_t count = 20000;
+    std::printf("%zu matrices per batch, times per matrix\n", count);
+    std::printf("%4s %8s %14s %14s %14s %14s %14s %14s\n", "n", "simd", "matrix mul ns", "batch mul ns",
+                "speedup", "matrix det ns", "batch det ns", "speedup");
+    for (std::size_t n : {4, 8, 16}) {
+        std::vector<Matrix> a, b;
+        MatrixBatch batch_a(count, n, n), batch_b(count, n, n);
+        for (std::size_t i = 0; i < count; ++i) {
+            a.push_back(RandomMatrix(n, n));
+            b.push_back(RandomMatrix(n, n));
+            batch_a.set(i, a[i]);
+            batch_b.set(i, b[i]);
+        }
+        std::vector<Matrix> products(count, Matrix(n, n));
+        std::vector<double> dets(count);
+        MatrixBatch batch_products(count, n, n);
+
+        double matrix_mul = BestTime([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                products[i] = a[i] * b[i];
+            }
+            DoNotOptimize(products);
+        });
+        double matrix_det = BestTime([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                dets[i] = a[i].det();
+            }
+            DoNotOptimize(dets);
+        });
+
+        for (auto level : {task::SimdLevel::SSE2, task::SimdLevel::AVX2}) {
+            task::set_simd_level(level);
+            double batch_mul = BestTime([&] {
+                multiply(batch_a, batch_b, batch_products);
+                DoNotOptimize(batch_products);
+            });
+            double batch_det = BestTime([&] {
+                batch_a.det(dets.data());
+                DoNotOptimize(dets);
+            });
+            std::printf("%4zu %8s %14.1f %14.1f %13.1fx %14.1f %14.1f %13.1fx\n", n,
+                        task::simd_level() == task::SimdLevel::AVX2 ? "avx2" : "sse2",
+                        matrix_mul / count * 1e9, batch_mul / count * 1e9, matrix_mul / batch_mul,
+                        matrix_det / count * 1e9, batch_det / count * 1e9, matrix_det / batch_det);
+        }
+        task::set_simd_level(task::max_simd_level());
+    }
+}
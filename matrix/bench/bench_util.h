@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <random>
+#include "src/matrix.h"
+
+
+// Runs fn repeatedly for at least min_seconds and returns the best time of a
+// single run in seconds.
+template <class Fn>
+double BestTime(Fn fn, double min_seconds = 0.2) {
+    using Clock = std::chrono::steady_clock;
+    double best = 1e300;
+    double total = 0;
+    int runs = 0;
+    while (total < min_seconds || runs < 3) {
+        auto start = Clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        best = elapsed < best ? elapsed : best;
+        total += elapsed;
+        runs++;
+    }
+    return best;
+}
+
+// Keeps the optimizer from discarding a computed value.
+template <class T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+task::Matrix RandomMatrix(std::size_t rows, std::size_t cols) {
+    static std::mt19937 rand(42);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+    task::Matrix temp(rows, cols);
+    for (std::size_t row = 0; row < rows; ++row) {
+        for (std::size_t col = 0; col < cols; ++col) {
+            temp[row][col] = dist(rand);
+        }
+    }
+    return temp;
+}
@@ -0,0 +1,36 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+
+
+using task::Matrix;
+
+
+int main() {
+    std::printf("%6s %14s %14s %8s\n", "n", "eager ms", "fused ms", "speedup");
+    for (std::size_t n : {64, 256, 1024, 2048}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = RandomMatrix(n, n);
+        Matrix c = RandomMatrix(n, n);
+        Matrix result(n, n);
+
+        // One temporary per operator, as before the expression layer.
+        double eager = BestTime([&] {
+            Matrix scaled = a;
+            scaled *= 2.;
+            Matrix sum = scaled;
+            sum += b;
+            Matrix negated = c;
+            negated *= -1.;
+            Matrix difference = sum;
+            difference += negated;
+            result = difference;
+            DoNotOptimize(result);
+        });
+        double fused = BestTime([&] {
+            result = a * 2. + b - c;
+            DoNotOptimize(result);
+        });
+
+        std::printf("%6zu %14.3f %14.3f %7.1fx\n", n, eager * 1e3, fused * 1e3, eager / fused);
+    }
+}
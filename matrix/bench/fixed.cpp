@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <vector>
+#include "bench/bench_util.h"
+#include "src/fixed_matrix.h"
+
+
+using task::Matrix;
+
+
+template <std::size_t N>
+void Run() {
+    const std::size_t count = 10000;
+    std::vector<Matrix> dynamic;
+    std::vector<task::FixedMatrix<double, N, N>> fixed;
+    for (std::size_t i = 0; i < count; i++) {
+        dynamic.push_back(RandomMatrix(N, N));
+        fixed.push_back(task::FixedMatrix<double, N, N>::from(dynamic.back()));
+    }
+
+    double dynamic_multiply = BestTime([&] {
+        for (std::size_t i = 0; i + 1 < count; i++) {
+            DoNotOptimize(dynamic[i] * dynamic[i + 1]);
+        }
+    });
+    double fixed_multiply = BestTime([&] {
+        for (std::size_t i = 0; i + 1 < count; i++) {
+            DoNotOptimize(fixed[i] * fixed[i + 1]);
+        }
+    });
+    double dynamic_det = BestTime([&] {
+        for (std::size_t i = 0; i < count; i++) {
+            DoNotOptimize(dynamic[i].det());
+        }
+    });
+    double fixed_det = BestTime([&] {
+        for (std::size_t i = 0; i < count; i++) {
+            DoNotOptimize(fixed[i].det());
+        }
+    });
+    double dynamic_add = BestTime([&] {
+        for (std::size_t i = 0; i + 1 < count; i++) {
+            DoNotOptimize(Matrix(dynamic[i] + dynamic[i + 1]));
+        }
+    });
+    double fixed_add = BestTime([&] {
+        for (std::size_t i = 0; i + 1 < count; i++) {
+            DoNotOptimize(fixed[i] + fixed[i + 1]);
+        }
+    });
+
+    std::printf("%4zux%zu %10.1f %10.1f %7.1fx %10.1f %10.1f %7.1fx %10.1f %10.1f %7.1fx\n", N, N,
+                dynamic_multiply / count * 1e9, fixed_multiply / count * 1e9,
+                dynamic_multiply / fixed_multiply,
+                dynamic_det / count * 1e9, fixed_det / count * 1e9, dynamic_det / fixed_det,
+                dynamic_add / count * 1e9, fixed_add / count * 1e9, dynamic_add / fixed_add);
+}
+
+
+int main() {
+    std::printf("%6s %10s %10s %8s %10s %10s %8s %10s %10s %8s\n", "shape",
+                "* dyn ns", "* fix ns", "speedup", "det dyn", "det fix", "speedup",
+                "+ dyn ns", "+ fix ns", "speedup");
+    Run<3>();
+    Run<4>();
+    Run<8>();
+}
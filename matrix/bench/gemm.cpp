@@ -0,0 +1,40 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+
+
+using task::Matrix;
+
+
+// The multiply that operator* used before the blocked kernel.
+Matrix NaiveMultiply(const Matrix& lhs, const Matrix& rhs) {
+    Matrix result(lhs.rows(), rhs.cols());
+    for (std::size_t i = 0; i < result.rows(); i++) {
+        for (std::size_t j = 0; j < result.cols(); j++) {
+            result[i][j] = 0;
+            for (std::size_t k = 0; k < lhs.cols(); k++) {
+                result[i][j] += lhs[i][k] * rhs[k][j];
+            }
+        }
+    }
+    return result;
+}
+
+
+int main() {
+    std::printf("%6s %14s %14s %8s\n", "n", "naive GFLOP/s", "gemm GFLOP/s", "speedup");
+    for (std::size_t n : {64, 128, 256, 512, 1024}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = RandomMatrix(n, n);
+        double flops = 2.0 * n * n * n;
+
+        double naive = n <= 512 ? BestTime([&] { DoNotOptimize(NaiveMultiply(a, b)); }) : 0;
+        double blocked = BestTime([&] { DoNotOptimize(a * b); });
+
+        if (naive > 0) {
+            std::printf("%6zu %14.2f %14.2f %7.1fx\n", n, flops / naive * 1e-9,
+                        flops / blocked * 1e-9, naive / blocked);
+        } else {
+            std::printf("%6zu %14s %14.2f %8s\n", n, "-", flops / blocked * 1e-9, "-");
+        }
+    }
+}
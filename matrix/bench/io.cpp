@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <fstream>
+#include "bench/bench_util.h"
+
+
+using task::Matrix;
+
+
+int main() {
+    const std::string text_path = "bench_io.txt";
+    const std::string binary_path = "bench_io.bin";
+
+    std::printf("%6s %12s %12s %12s %12s %12s\n", "n", "text out ms", "text in ms",
+                "bin out ms", "bin in ms", "mmap ms");
+    for (std::size_t n : {256, 1024, 2048}) {
+        Matrix mat = RandomMatrix(n, n);
+
+        double text_out = BestTime([&] {
+            std::ofstream output(text_path);
+            output.precision(17);
+            output << n << " " << n << "\n" << mat;
+        }, 0);
+        double text_in = BestTime([&] {
+            std::ifstream input(text_path);
+            Matrix loaded;
+            input >> loaded;
+            DoNotOptimize(loaded);
+        }, 0);
+        double binary_out = BestTime([&] { task::write_binary(binary_path, mat); });
+        double binary_in = BestTime([&] { DoNotOptimize(task::read_binary(binary_path)); });
+        // Mapping alone is lazy, so touch every element once.
+        double mapped = BestTime([&] {
+            auto file = Matrix::mmap_open(binary_path);
+            DoNotOptimize(file.view() == mat);
+        });
+
+        std::printf("%6zu %12.2f %12.2f %12.2f %12.2f %12.2f\n", n, text_out * 1e3, text_in * 1e3,
+                    binary_out * 1e3, binary_in * 1e3, mapped * 1e3);
+    }
+    std::remove(text_path.c_str());
+    std::remove(binary_path.c_str());
+}
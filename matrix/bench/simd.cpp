@@ -0,0 +1,47 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/simd.h"
+
+
+using task::Matrix;
+using task::SimdLevel;
+
+
+const char* LevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+
+int main() {
+    std::printf("%6s %-8s %10s %10s %10s %10s %10s %10s\n", "n", "level",
+                "+ us", "- us", "neg us", "*s us", "trace ns", "== us");
+    for (std::size_t n : {64, 512}) {
+        for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+            if (level > task::max_simd_level()) {
+                continue;
+            }
+            Matrix a = RandomMatrix(n, n);
+            Matrix b = RandomMatrix(n, n);
+            Matrix result(n, n);
+            Matrix equal = a;
+
+            task::set_simd_level(level);
+            double add = BestTime([&] { result = a + b; DoNotOptimize(result); });
+            double subtract = BestTime([&] { result = a - b; DoNotOptimize(result); });
+            double negate = BestTime([&] { result = -a; DoNotOptimize(result); });
+            double scale = BestTime([&] { result = a * 1.5; DoNotOptimize(result); });
+            double trace = BestTime([&] { DoNotOptimize(a.trace()); });
+            double compare = BestTime([&] { DoNotOptimize(a == equal); });
+            std::printf("%6zu %-8s %10.2f %10.2f %10.2f %10.2f %10.1f %10.2f\n", n, LevelName(level),
+                        add * 1e6, subtract * 1e6, negate * 1e6, scale * 1e6, trace * 1e9,
+                        compare * 1e6);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+
+
+using task::Matrix;
+
+
+int main() {
+    const std::size_t n = 512;
+    Matrix a = RandomMatrix(n, n);
+    Matrix spd = a.transposed() * a + Matrix(n, n) * double(n);
+
+    double lu_time = BestTime([&] {
+        task::LU lu(a);
+        DoNotOptimize(lu);
+    });
+    double cholesky_time = BestTime([&] {
+        task::Cholesky cholesky(spd);
+        DoNotOptimize(cholesky);
+    });
+    std::printf("n = %zu: LU %.1f ms, Cholesky %.1f ms\n\n", n, lu_time * 1e3, cholesky_time * 1e3);
+
+    std::printf("%6s %16s %16s %16s\n", "rhs", "refactor ms", "reuse LU ms", "batched ms");
+    for (std::size_t k : {1, 8, 64, 256}) {
+        Matrix b = RandomMatrix(n, k);
+
+        // Factorization for every right-hand side, as with Matrix::solve.
+        double refactor = BestTime([&] {
+            for (std::size_t j = 0; j < k; ++j) {
+                Matrix x = a.solve(b.block(0, j, n, 1));
+                DoNotOptimize(x);
+            }
+        }, 0);
+        task::LU lu(a);
+        double reuse = BestTime([&] {
+            for (std::size_t j = 0; j < k; ++j) {
+                Matrix x = lu.solve(b.block(0, j, n, 1));
+                DoNotOptimize(x);
+            }
+        });
+        double batched = BestTime([&] {
+            Matrix x = lu.solve(b);
+            DoNotOptimize(x);
+        });
+
+        std::printf("%6zu %16.2f %16.2f %16.2f\n", k, refactor * 1e3, reuse * 1e3, batched * 1e3);
+    }
+}
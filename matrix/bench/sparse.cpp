@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench/bench_util.h"
+#include "src/sparse_matrix.h"
+
+
+using task::Matrix;
+using task::CsrMatrix;
+
+
+// Random matrix with about density * rows * cols nonzero elements.
+Matrix RandomSparse(std::size_t rows, std::size_t cols, double density) {
+    static std::mt19937 rand(7);
+    std::uniform_real_distribution<double> unit{0., 1.};
+    Matrix result = RandomMatrix(rows, cols);
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t j = 0; j < cols; ++j) {
+            if (unit(rand) >= density) {
+                result[i][j] = 0;
+            }
+        }
+    }
+    return result;
+}
+
+
+int main() {
+    const std::size_t n = 2048;
+    const std::size_t k = 64;
+    Matrix x = RandomMatrix(n, 1);
+    Matrix b = RandomMatrix(n, k);
+    std::vector<double> xs(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        xs[i] = x[i][0];
+    }
+
+    std::printf("n = %zu, dense operand of %zu columns\n", n, k);
+    std::printf("%8s %12s %12s %8s %12s %12s %8s\n", "density", "dense mv ms", "spmv ms", "speedup",
+                "dense mm ms", "spmm ms", "speedup");
+    for (double density : {0.001, 0.01, 0.05, 0.1, 0.25, 0.5}) {
+        Matrix a = RandomSparse(n, n, density);
+        CsrMatrix sparse(a);
+
+        double dense_mv = BestTime([&] {
+            Matrix y = a * x;
+            DoNotOptimize(y);
+        });
+        double sparse_mv = BestTime([&] {
+            std::vector<double> y = sparse * xs;
+            DoNotOptimize(y);
+        });
+        double dense_mm = BestTime([&] {
+            Matrix y = a * b;
+            DoNotOptimize(y);
+        });
+        double sparse_mm = BestTime([&] {
+            Matrix y = sparse * b;
+            DoNotOptimize(y);
+        });
+
+        std::printf("%7.1f%% %12.3f %12.3f %7.1fx %12.3f %12.3f %7.1fx\n", density * 100,
+                    dense_mv * 1e3, sparse_mv * 1e3, dense_mv / sparse_mv,
+                    dense_mm * 1e3, sparse_mm * 1e3, dense_mm / sparse_mm);
+    }
+
+    const std::size_t m = 1024;
+    std::printf("\nsparse-sparse product, n = %zu\n", m);
+    std::printf("%8s %12s %12s %8s\n", "density", "dense ms", "sparse ms", "speedup");
+    for (double density : {0.001, 0.01, 0.05, 0.1}) {
+        Matrix a = RandomSparse(m, m, density);
+        Matrix c = RandomSparse(m, m, density);
+        CsrMatrix sparse_a(a), sparse_c(c);
+
+        double dense = BestTime([&] {
+            Matrix y = a * c;
+            DoNotOptimize(y);
+        });
+        double sparse = BestTime([&] {
+            CsrMatrix y = sparse_a * sparse_c;
+            DoNotOptimize(y);
+        });
+
+        std::printf("%7.1f%% %12.3f %12.3f %7.1fx\n", density * 100, dense * 1e3, sparse * 1e3,
+                    dense / sparse);
+    }
+}
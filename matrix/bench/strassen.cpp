@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/strassen.h"
+
+
+using task::Matrix;
+using task::ProductAlgorithm;
+
+
+// Largest element-wise difference relative to the largest element of expected.
+double RelativeError(const Matrix& result, const Matrix& expected) {
+    double error = 0, scale = 0;
+    for (std::size_t i = 0; i < expected.rows(); ++i) {
+        for (std::size_t j = 0; j < expected.cols(); ++j) {
+            error = std::max(error, std::fabs(result.get(i, j) - expected.get(i, j)));
+            scale = std::max(scale, std::fabs(expected.get(i, j)));
+        }
+    }
+    return error / scale;
+}
+
+
+int main() {
+    std::printf("%6s %8s %14s %14s %8s %12s\n", "n", "cutoff", "classical ms", "strassen ms",
+                "speedup", "rel. error");
+    for (std::size_t n : {512, 1024, 2048}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = RandomMatrix(n, n);
+        Matrix classical = a * b;
+        double classical_time = BestTime([&] {
+            Matrix product = a * b;
+            DoNotOptimize(product);
+        }, 0);
+
+        for (std::size_t cutoff : {64, 128, 256, 512}) {
+            if (cutoff >= n)
+                continue;
+            task::set_product_algorithm(ProductAlgorithm::Strassen, cutoff);
+            Matrix strassen = a * b;
+            double strassen_time = BestTime([&] {
+                Matrix product = a * b;
+                DoNotOptimize(product);
+            }, 0);
+            task::set_product_algorithm(ProductAlgorithm::Classical);
+
+            std::printf("%6zu %8zu %14.1f %14.1f %7.2fx %12.2e\n", n, cutoff, classical_time * 1e3,
+                        strassen_time * 1e3, classical_time / strassen_time,
+                        RelativeError(strassen, classical));
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include "bench/bench_util.h"
+#include "src/thread_pool.h"
+
+
+using task::Matrix;
+
+
+int main() {
+    std::size_t max_threads = std::max(std::thread::hardware_concurrency(), 4u);
+    Matrix a = RandomMatrix(1024, 1024);
+    Matrix b = RandomMatrix(1024, 1024);
+    Matrix square = RandomMatrix(512, 512);
+    Matrix result(1024, 1024);
+
+    std::printf("%8s %12s %14s %14s %12s\n", "threads", "* GFLOP/s", "transposed ms",
+                "a*2+b-a ms", "det ms");
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        task::set_num_threads(threads);
+        double multiply = BestTime([&] { DoNotOptimize(a * b); });
+        double transpose = BestTime([&] { DoNotOptimize(a.transposed()); });
+        double elementwise = BestTime([&] { result = a * 2. + b - a; DoNotOptimize(result); });
+        double det = BestTime([&] { DoNotOptimize(square.det()); });
+        std::printf("%8zu %12.2f %14.2f %14.2f %12.2f\n", threads, 2e-9 * 1024 * 1024 * 1024 / multiply,
+                    transpose * 1e3, elementwise * 1e3, det * 1e3);
+    }
+}
@@ -0,0 +1,34 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+
+
+using task::Matrix;
+
+
+// transpose() before the cache-oblivious kernels: strided scatter into a new
+// matrix, then a copy back.
+void NaiveTranspose(Matrix& mat) {
+    Matrix result(mat.cols(), mat.rows());
+    for (std::size_t i = 0; i < mat.rows(); i++) {
+        for (std::size_t j = 0; j < mat.cols(); j++) {
+            result[j][i] = mat[i][j];
+        }
+    }
+    mat = result;
+}
+
+
+int main() {
+    std::printf("%12s %12s %15s %15s\n", "shape", "naive ms", "transposed() ms", "transpose() ms");
+    for (auto shape : {std::make_pair(1024, 1024), std::make_pair(4096, 4096),
+                       std::make_pair(100000, 16), std::make_pair(2000, 300)}) {
+        Matrix mat = RandomMatrix(shape.first, shape.second);
+        double naive = BestTime([&] { NaiveTranspose(mat); });
+        double copy = BestTime([&] { DoNotOptimize(mat.transposed()); });
+        double in_place = BestTime([&] { mat.transpose(); });
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%dx%d", shape.first, shape.second);
+        std::printf("%12s %12.2f %15.2f %15.2f\n", name, naive * 1e3, copy * 1e3, in_place * 1e3);
+    }
+}
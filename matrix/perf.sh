@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Performance suite. Writes perf/results.json and compares it with
+# perf/baseline.json when there is one; --save makes the run the new
+# baseline. Other arguments go to the suite, e.g.
+#   bash perf.sh --filter multiply --max-size 1024
+# TOLERANCE sets the allowed relative slowdown (default 0.1).
+
+set -e
+
+SAVE=0
+ARGS=()
+for arg in "$@"; do
+    if [ "$arg" == "--save" ]; then
+        SAVE=1
+    else
+        ARGS+=("$arg")
+    fi
+done
+
+g++ -std=c++17 -O2 -DNDEBUG -I./ perf/suite.cpp src/*.cpp -pthread -o perf_suite
+./perf_suite --output perf/results.json "${ARGS[@]}"
+rm perf_suite
+
+if [ $SAVE == 1 ]; then
+    cp perf/results.json perf/baseline.json
+    echo Baseline saved to perf/baseline.json
+elif [ -f perf/baseline.json ]; then
+    python3 perf/compare.py perf/baseline.json perf/results.json --tolerance "${TOLERANCE:-0.1}"
+fi
@@ -0,0 +1,70 @@
+"""Compares two perf suite result files and flags regressions.
+
+    python3 perf/compare.py BASELINE CURRENT [--tolerance 0.1]
+
+A case regresses when its time grows by more than the tolerance (relative)
+or when it allocates more than before. The exit status is 1 if any case
+regressed, so the script can gate a build.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {(r["name"], r["n"]): r for r in data["results"]}, data
+
+
+def format_time(seconds):
+    if seconds < 1e-3:
+        return "%.3f us" % (seconds * 1e6)
+    return "%.3f ms" % (seconds * 1e3)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="allowed relative slowdown (default 0.1)")
+    args = parser.parse_args()
+
+    baseline, baseline_meta = load(args.baseline)
+    current, current_meta = load(args.current)
+    for key in ("simd", "threads"):
+        if baseline_meta.get(key) != current_meta.get(key):
+            print("warning: %s differs (%s vs %s)" % (key, baseline_meta.get(key), current_meta.get(key)))
+
+    regressions = 0
+    print("%-20s %6s %14s %14s %8s %14s" % ("case", "n", "baseline", "current", "ratio", "allocs"))
+    for key in sorted(current, key=lambda k: (k[0], k[1])):
+        if key not in baseline:
+            continue
+        old, new = baseline[key], current[key]
+        ratio = new["seconds"] / old["seconds"]
+        status = []
+        if ratio > 1 + args.tolerance:
+            status.append("SLOWER")
+        elif ratio < 1 - args.tolerance:
+            status.append("faster")
+        if new["allocations"] > old["allocations"]:
+            status.append("MORE ALLOCATIONS")
+        if "SLOWER" in status or "MORE ALLOCATIONS" in status:
+            regressions += 1
+        allocs = "%d -> %d" % (old["allocations"], new["allocations"])
+        print("%-20s %6d %14s %14s %7.2fx %14s %s" % (key[0], key[1], format_time(old["seconds"]),
+                                                     format_time(new["seconds"]), ratio, allocs,
+                                                     " ".join(status)))
+
+    missing = sorted(set(baseline) - set(current))
+    if missing:
+        print("not measured this time: %s" % ", ".join("%s/%d" % key for key in missing))
+    print("%d regression(s)" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,299 @@
+// Matrix performance suite: times the core operations over a range of sizes
+// and writes the results as JSON for perf/compare.py. Run through perf.sh.
+//
+//   suite [--output FILE] [--filter NAME] [--min-size N] [--max-size N]
+//         [--min-time SECONDS]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bench/bench_util.h"
+#include "src/matrix_io.h"
+#include "src/simd.h"
+#include "src/thread_pool.h"
+
+
+using task::Matrix;
+
+
+std::size_t allocation_count = 0;
+std::size_t allocated_bytes = 0;
+
+void* operator new(std::size_t size) {
+    ++allocation_count;
+    allocated_bytes += size;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    ++allocation_count;
+    allocated_bytes += size;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+
+struct Options {
+    std::string output = "perf/results.json";
+    std::string filter;
+    std::size_t min_size = 4;
+    std::size_t max_size = 4096;
+    double min_time = 0.2;
+};
+
+struct Result {
+    std::string name;
+    std::size_t n;
+    double seconds;
+    double gflops;
+    double allocations;
+    double bytes;
+};
+
+// An operation on n x n matrices: setup builds the operands once, the
+// returned function is what gets timed.
+struct Case {
+    std::string name;
+    std::size_t max_size;
+    std::function<double(std::size_t)> flops;
+    std::function<std::function<void()>(std::size_t)> setup;
+};
+
+
+// Runs fn until min_time has passed (at least once, after a warm-up run when
+// a run is short) and returns the best time with the allocations of one run.
+Result Measure(const std::function<void()>& fn, double min_time) {
+    using Clock = std::chrono::steady_clock;
+    Result result{};
+    auto start = Clock::now();
+    fn();
+    double first = std::chrono::duration<double>(Clock::now() - start).count();
+    double best = first, total = first;
+    int runs = 1;
+    while (total < min_time) {
+        std::size_t count = allocation_count, bytes = allocated_bytes;
+        start = Clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        result.allocations = double(allocation_count - count);
+        result.bytes = double(allocated_bytes - bytes);
+        best = elapsed < best ? elapsed : best;
+        total += elapsed;
+        runs++;
+    }
+    if (runs == 1) {
+        std::size_t count = allocation_count, bytes = allocated_bytes;
+        fn();
+        result.allocations = double(allocation_count - count);
+        result.bytes = double(allocated_bytes - bytes);
+    }
+    result.seconds = best;
+    return result;
+}
+
+double Cube(std::size_t n) {
+    return double(n) * double(n) * double(n);
+}
+
+std::vector<Case> Cases() {
+    std::vector<Case> cases;
+    cases.push_back({"multiply", 4096, [](std::size_t n) { return 2 * Cube(n); }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n), b = RandomMatrix(n, n);
+        return std::function<void()>([a, b]() {
+            Matrix c = a * b;
+            DoNotOptimize(c);
+        });
+    }});
+    cases.push_back({"det", 4096, [](std::size_t n) { return 2 * Cube(n) / 3; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n);
+        return std::function<void()>([a]() {
+            double det = a.det();
+            DoNotOptimize(det);
+        });
+    }});
+    cases.push_back({"transposed", 4096, [](std::size_t) { return 0.; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n + 1);
+        return std::function<void()>([a]() {
+            Matrix t = a.transposed();
+            DoNotOptimize(t);
+        });
+    }});
+    cases.push_back({"transpose_in_place", 4096, [](std::size_t) { return 0.; }, [](std::size_t n) {
+        auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+        return std::function<void()>([a]() {
+            a->transpose();
+            DoNotOptimize(*a);
+        });
+    }});
+    cases.push_back({"add", 4096, [](std::size_t n) { return double(n) * n; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n), b = RandomMatrix(n, n);
+        auto c = std::make_shared<Matrix>(n, n);
+        return std::function<void()>([a, b, c]() {
+            *c = a + b;
+            DoNotOptimize(*c);
+        });
+    }});
+    cases.push_back({"axpy_expression", 4096, [](std::size_t n) { return 3. * n * n; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n), b = RandomMatrix(n, n);
+        auto c = std::make_shared<Matrix>(n, n);
+        return std::function<void()>([a, b, c]() {
+            *c = a * 2. + b - a;
+            DoNotOptimize(*c);
+        });
+    }});
+    cases.push_back({"scale_in_place", 4096, [](std::size_t n) { return double(n) * n; }, [](std::size_t n) {
+        auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+        return std::function<void()>([a]() {
+            *a *= 1.000001;
+            DoNotOptimize(*a);
+        });
+    }});
+    cases.push_back({"copy", 4096, [](std::size_t) { return 0.; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n);
+        return std::function<void()>([a]() {
+            Matrix copy = a;
+            DoNotOptimize(copy);
+        });
+    }});
+    cases.push_back({"resize", 4096, [](std::size_t) { return 0.; }, [](std::size_t n) {
+        auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+        return std::function<void()>([a, n]() {
+            a->resize(n + 1, n);
+            a->resize(n, n);
+            DoNotOptimize(*a);
+        });
+    }});
+    cases.push_back({"io_binary", 4096, [](std::size_t) { return 0.; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n);
+        return std::function<void()>([a]() {
+            std::stringstream stream;
+            task::write_binary(stream, a);
+            Matrix b = task::read_binary(stream);
+            DoNotOptimize(b);
+        });
+    }});
+    cases.push_back({"io_text", 1024, [](std::size_t) { return 0.; }, [](std::size_t n) {
+        auto a = RandomMatrix(n, n);
+        return std::function<void()>([a]() {
+            std::stringstream stream;
+            stream << a.rows() << ' ' << a.cols() << '\n' << a;
+            Matrix b;
+            stream >> b;
+            DoNotOptimize(b);
+        });
+    }});
+    return cases;
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i], value = argv[i + 1];
+        if (flag == "--output") {
+            options.output = value;
+        } else if (flag == "--filter") {
+            options.filter = value;
+        } else if (flag == "--min-size") {
+            options.min_size = std::stoul(value);
+        } else if (flag == "--max-size") {
+            options.max_size = std::stoul(value);
+        } else if (flag == "--min-time") {
+            options.min_time = std::stod(value);
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", flag.c_str());
+            std::exit(2);
+        }
+    }
+    return options;
+}
+
+void WriteJson(const std::string& path, const std::vector<Result>& results) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        std::perror(path.c_str());
+        std::exit(1);
+    }
+    const char* levels[] = {"scalar", "sse2", "avx2"};
+    std::fprintf(file, "{\n  \"simd\": \"%s\",\n  \"threads\": %zu,\n  \"results\": [\n",
+                 levels[static_cast<int>(task::simd_level())], task::num_threads());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(file, "    {\"name\": \"%s\", \"n\": %zu, \"seconds\": %.9g, \"gflops\": %.6g, "
+                     "\"allocations\": %.0f, \"bytes\": %.0f}%s\n", r.name.c_str(), r.n, r.seconds,
+                     r.gflops, r.allocations, r.bytes, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
+}
+
+
+int main(int argc, char** argv) {
+    Options options = ParseOptions(argc, argv);
+    std::vector<Result> results;
+    std::printf("%-20s %6s %14s %10s %8s %14s\n", "case", "n", "time", "GFLOP/s", "allocs", "bytes");
+    for (const Case& c : Cases()) {
+        if (!options.filter.empty() && c.name.find(options.filter) == std::string::npos)
+            continue;
+        for (std::size_t n = options.min_size; n <= options.max_size && n <= c.max_size; n *= 4) {
+            Result result = Measure(c.setup(n), options.min_time);
+            result.name = c.name;
+            result.n = n;
+            double flops = c.flops(n);
+            result.gflops = flops > 0 ? flops / result.seconds * 1e-9 : 0;
+            results.push_back(result);
+
+            char time[32];
+            if (result.seconds < 1e-3) {
+                std::snprintf(time, sizeof(time), "%.3f us", result.seconds * 1e6);
+            } else {
+                std::snprintf(time, sizeof(time), "%.3f ms", result.seconds * 1e3);
+            }
+            std::printf("%-20s %6zu %14s %10.2f %8.0f %14.0f\n", c.name.c_str(), n, time,
+                        result.gflops, result.allocations, result.bytes);
+            std::fflush(stdout);
+        }
+    }
+    WriteJson(options.output, results);
+    std::printf("results written to %s\n", options.output.c_str());
+}
@@ -0,0 +1,37 @@
+#include "accumulation.h"
+#include "buffer_pool.h"
+#include "thread_pool.h"
+#include <atomic>
+
+using namespace task;
+
+namespace {
+
+// Atomic because products read it from any thread, pool workers included.
+std::atomic<Accumulation> policy_value(Accumulation::Plain);
+
+// Smallest number of multiply-adds worth handing to a thread in a product.
+const std::size_t ACCUMULATION_GRAIN = 1 << 20;
+
+}  // namespace
+
+void task::set_accumulation(Accumulation policy) {
+	policy_value.store(policy, std::memory_order_relaxed);
+}
+
+Accumulation task::accumulation() {
+	return policy_value.load(std::memory_order_relaxed);
+}
+
+void task::detail::parallel_accumulate_product(Accumulation policy, std::size_t m, std::size_t n,
+											   std::size_t k, const double* a, std::size_t lda,
+											   const double* b, std::size_t ldb,
+											   double* c, std::size_t ldc) {
+	std::size_t row_work = std::max<std::size_t>(n * k, 1);
+	parallel_for(m, ACCUMULATION_GRAIN / row_work + 1, [&](std::size_t begin, std::size_t end) {
+		std::size_t capacity;
+		double* work = allocate_buffer(accumulation_workspace(policy, k) + ACCUMULATION_COLUMNS, capacity);
+		accumulate_product(policy, end - begin, n, k, a + begin*lda, lda, b, ldb, c + begin*ldc, ldc, work);
+		release_buffer(work, capacity);
+	});
+}
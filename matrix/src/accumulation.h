@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+
+namespace task {
+
+// How the reductions of the products and traces of task::Matrix and
+// task::BasicMatrix sum up their terms.
+//   Plain     one accumulator of the element type (the fastest).
+//   Widened   accumulates a float matrix in double; the same as Plain for
+//             double and integer elements.
+//   Kahan     compensated summation: the rounding error of every addition is
+//             carried into the next one, so the error does not grow with the
+//             number of terms.
+//   Pairwise  blocks of PAIRWISE_BLOCK terms summed plainly, then combined as
+//             a balanced tree; the error grows with the log of the length.
+// Kahan and Pairwise replace the blocked product kernel (and Strassen) with
+// a simpler one and are several times slower; integer elements are exact
+// and ignore the policy. The policy may be changed while other threads
+// compute; each product or trace reads it once.
+enum class Accumulation {
+	Plain,
+	Widened,
+	Kahan,
+	Pairwise
+};
+
+void set_accumulation(Accumulation policy);
+Accumulation accumulation();
+
+namespace detail {
+
+const std::size_t PAIRWISE_BLOCK = 32;
+// Columns of a product row accumulated together, so that the accumulators of
+// a chunk stay in cache.
+const std::size_t ACCUMULATION_COLUMNS = 256;
+
+template <class T>
+using WidenedType = typename std::conditional<std::is_same<T, float>::value, double, T>::type;
+
+// Elements of scratch space needed by accumulate_product.
+inline std::size_t accumulation_workspace(Accumulation policy, std::size_t k) {
+	std::size_t columns = ACCUMULATION_COLUMNS;
+	if (policy == Accumulation::Kahan)
+		return 2 * columns;
+	if (policy != Accumulation::Pairwise)
+		return columns;
+	// One partial sum per set bit of the block count, plus the one being built.
+	std::size_t depth = 1;
+	for (std::size_t blocks = (k + PAIRWISE_BLOCK - 1) / PAIRWISE_BLOCK; blocks > 0; blocks /= 2) {
+		depth++;
+	}
+	return (depth + 1) * columns;
+}
+
+// out[j] = sum over p < k of a[p] * b[p*ldb + j] for j < n, n at most
+// ACCUMULATION_COLUMNS, summed according to policy.
+template <class T, class Acc>
+void accumulate_row(Accumulation policy, std::size_t n, std::size_t k, const T* a,
+					const T* b, std::size_t ldb, Acc* out, Acc* work) {
+	std::fill(out, out + n, Acc(0));
+	if (policy == Accumulation::Kahan) {
+		Acc* compensation = work;
+		std::fill(compensation, compensation + n, Acc(0));
+		for (std::size_t p = 0; p < k; p++) {
+			Acc factor = a[p];
+			const T* row = b + p*ldb;
+			for (std::size_t j = 0; j < n; j++) {
+				Acc y = factor * Acc(row[j]) - compensation[j];
+				Acc t = out[j] + y;
+				compensation[j] = (t - out[j]) - y;
+				out[j] = t;
+			}
+		}
+	} else if (policy == Accumulation::Pairwise) {
+		// A binary counter of block sums: level d holds the sum of 2^d blocks,
+		// and two sums of the same size are merged as soon as they exist.
+		Acc* stack = work;
+		std::size_t depth = 0;
+		std::size_t blocks = 0;
+		for (std::size_t start = 0; start < k; start += PAIRWISE_BLOCK) {
+			Acc* top = stack + depth*n;
+			std::fill(top, top + n, Acc(0));
+			for (std::size_t p = start; p < std::min(start + PAIRWISE_BLOCK, k); p++) {
+				Acc factor = a[p];
+				const T* row = b + p*ldb;
+				for (std::size_t j = 0; j < n; j++) {
+					top[j] += factor * Acc(row[j]);
+				}
+			}
+			depth++;
+			blocks++;
+			for (std::size_t count = blocks; count % 2 == 0; count /= 2) {
+				Acc* lower = stack + (depth - 2)*n;
+				Acc* upper = stack + (depth - 1)*n;
+				for (std::size_t j = 0; j < n; j++) {
+					lower[j] += upper[j];
+				}
+				depth--;
+			}
+		}
+		// The leftover sums, smallest first.
+		for (std::size_t d = depth; d-- > 0;) {
+			const Acc* partial = stack + d*n;
+			for (std::size_t j = 0; j < n; j++) {
+				out[j] += partial[j];
+			}
+		}
+	} else {
+		for (std::size_t p = 0; p < k; p++) {
+			Acc factor = a[p];
+			const T* row = b + p*ldb;
+			for (std::size_t j = 0; j < n; j++) {
+				out[j] += factor * Acc(row[j]);
+			}
+		}
+	}
+}
+
+// C = A * B with the gemm operand conventions, summed in Acc according to
+// policy. work holds accumulation_workspace(policy, k) + ACCUMULATION_COLUMNS
+// elements.
+template <class T, class Acc>
+void accumulate_product(Accumulation policy, std::size_t m, std::size_t n, std::size_t k,
+						const T* a, std::size_t lda, const T* b, std::size_t ldb,
+						T* c, std::size_t ldc, Acc* work) {
+	Acc* out = work + accumulation_workspace(policy, k);
+	for (std::size_t jc = 0; jc < n; jc += ACCUMULATION_COLUMNS) {
+		std::size_t columns = std::min(ACCUMULATION_COLUMNS, n - jc);
+		for (std::size_t i = 0; i < m; i++) {
+			accumulate_row(policy, columns, k, a + i*lda, b + jc, ldb, out, work);
+			for (std::size_t j = 0; j < columns; j++) {
+				c[i*ldc + jc + j] = T(out[j]);
+			}
+		}
+	}
+}
+
+// Sum of a[i*stride] for i < n according to policy.
+template <class T, class Acc>
+Acc accumulate_sum(Accumulation policy, const T* a, std::size_t stride, std::size_t n) {
+	if (policy == Accumulation::Pairwise && n > PAIRWISE_BLOCK) {
+		std::size_t half = n / 2;
+		return accumulate_sum<T, Acc>(policy, a, stride, half) +
+			   accumulate_sum<T, Acc>(policy, a + half*stride, stride, n - half);
+	}
+	Acc sum = Acc(0);
+	Acc compensation = Acc(0);
+	for (std::size_t i = 0; i < n; i++) {
+		if (policy == Accumulation::Kahan) {
+			Acc y = Acc(a[i*stride]) - compensation;
+			Acc t = sum + y;
+			compensation = (t - sum) - y;
+			sum = t;
+		} else {
+			sum += Acc(a[i*stride]);
+		}
+	}
+	return sum;
+}
+
+// accumulate_product for double matrices, split into bands of rows over the
+// thread pool.
+void parallel_accumulate_product(Accumulation policy, std::size_t m, std::size_t n, std::size_t k,
+								 const double* a, std::size_t lda,
+								 const double* b, std::size_t ldb,
+								 double* c, std::size_t ldc);
+
+}  // namespace detail
+}  // namespace task
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "accumulation.h"
+#include "matrix.h"
+
+
+namespace task {
+
+// Dynamic matrix over an arbitrary arithmetic element type, e.g. float or
+// int64_t. task::Matrix remains the double-precision matrix with the full
+// feature set; BasicMatrix covers the same core operations for other types
+// and converts to and from it.
+template <class T>
+class BasicMatrix {
+public:
+	using value_type = T;
+
+	BasicMatrix() : BasicMatrix(1, 1) {}
+
+	// Ones on the main diagonal, zeros elsewhere, like task::Matrix.
+	BasicMatrix(std::size_t rows, std::size_t cols)
+			: data_(new T[rows*cols]()), rows_(rows), cols_(cols) {
+		for (std::size_t i = 0; i < rows && i < cols; i++) {
+			data_[i*cols + i] = T(1);
+		}
+	}
+
+	explicit BasicMatrix(const ConstMatrixView& matrix)
+			: data_(new T[matrix.rows()*matrix.cols()]), rows_(matrix.rows()), cols_(matrix.cols()) {
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				data_[i*cols_ + j] = static_cast<T>(matrix(i, j));
+			}
+		}
+	}
+
+	BasicMatrix(const BasicMatrix& copy)
+			: data_(new T[copy.rows_*copy.cols_]), rows_(copy.rows_), cols_(copy.cols_) {
+		std::copy(copy.data_, copy.data_ + rows_*cols_, data_);
+	}
+
+	BasicMatrix(BasicMatrix&& other) noexcept
+			: data_(other.data_), rows_(other.rows_), cols_(other.cols_) {
+		other.data_ = nullptr;
+		other.rows_ = 0;
+		other.cols_ = 0;
+	}
+
+	~BasicMatrix() {
+		delete[] data_;
+	}
+
+	BasicMatrix& operator=(const BasicMatrix& a) {
+		if (this != &a) {
+			BasicMatrix copy(a);
+			swap(copy);
+		}
+		return *this;
+	}
+
+	BasicMatrix& operator=(BasicMatrix&& a) noexcept {
+		swap(a);
+		return *this;
+	}
+
+	void swap(BasicMatrix& other) noexcept {
+		std::swap(data_, other.data_);
+		std::swap(rows_, other.rows_);
+		std::swap(cols_, other.cols_);
+	}
+
+	Matrix to_matrix() const {
+		Matrix result(rows_, cols_, UNINITIALIZED);
+		for (std::size_t i = 0; i < rows_; i++) {
+			double* row = result.row_data(i);
+			for (std::size_t j = 0; j < cols_; j++) {
+				row[j] = static_cast<double>(data_[i*cols_ + j]);
+			}
+		}
+		return result;
+	}
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+	T* data() {
+		return data_;
+	}
+
+	const T* data() const {
+		return data_;
+	}
+
+	T& operator()(std::size_t row, std::size_t col) {
+		return data_[row*cols_ + col];
+	}
+
+	const T& operator()(std::size_t row, std::size_t col) const {
+		return data_[row*cols_ + col];
+	}
+
+	T& get(std::size_t row, std::size_t col) {
+		check_bounds(row, col);
+		return data_[row*cols_ + col];
+	}
+
+	const T& get(std::size_t row, std::size_t col) const {
+		check_bounds(row, col);
+		return data_[row*cols_ + col];
+	}
+
+	void set(std::size_t row, std::size_t col, const T& value) {
+		get(row, col) = value;
+	}
+
+	BasicMatrix& operator+=(const BasicMatrix& a) {
+		check_same_shape(a);
+		for (std::size_t i = 0; i < rows_*cols_; i++) {
+			data_[i] += a.data_[i];
+		}
+		return *this;
+	}
+
+	BasicMatrix& operator-=(const BasicMatrix& a) {
+		check_same_shape(a);
+		for (std::size_t i = 0; i < rows_*cols_; i++) {
+			data_[i] -= a.data_[i];
+		}
+		return *this;
+	}
+
+	BasicMatrix& operator*=(const T& number) {
+		for (std::size_t i = 0; i < rows_*cols_; i++) {
+			data_[i] *= number;
+		}
+		return *this;
+	}
+
+	BasicMatrix operator+(const BasicMatrix& a) const {
+		BasicMatrix result(*this);
+		return std::move(result += a);
+	}
+
+	BasicMatrix operator-(const BasicMatrix& a) const {
+		BasicMatrix result(*this);
+		return std::move(result -= a);
+	}
+
+	BasicMatrix operator*(const T& number) const {
+		BasicMatrix result(*this);
+		return std::move(result *= number);
+	}
+
+	BasicMatrix operator-() const {
+		return *this * T(-1);
+	}
+
+	BasicMatrix operator+() const {
+		return *this;
+	}
+
+	// i-k-j order keeps the inner loop on contiguous rows of both operands.
+	// Floating-point elements follow task::accumulation().
+	BasicMatrix operator*(const BasicMatrix& a) const {
+		if (cols_ != a.rows_)
+			throw SizeMismatchException();
+		BasicMatrix result(rows_, a.cols_);
+		if constexpr (std::is_floating_point<T>::value) {
+			Accumulation policy = accumulation();
+			if (policy == Accumulation::Widened) {
+				accumulate_into<detail::WidenedType<T>>(policy, a, result);
+				return result;
+			}
+			if (policy != Accumulation::Plain) {
+				accumulate_into<T>(policy, a, result);
+				return result;
+			}
+		}
+		std::fill(result.data_, result.data_ + rows_*a.cols_, T(0));
+		for (std::size_t i = 0; i < rows_; i++) {
+			T* out = result.data_ + i*a.cols_;
+			for (std::size_t k = 0; k < cols_; k++) {
+				T factor = data_[i*cols_ + k];
+				const T* row = a.data_ + k*a.cols_;
+				for (std::size_t j = 0; j < a.cols_; j++) {
+					out[j] += factor * row[j];
+				}
+			}
+		}
+		return result;
+	}
+
+	BasicMatrix transposed() const {
+		BasicMatrix result(cols_, rows_);
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				result.data_[j*rows_ + i] = data_[i*cols_ + j];
+			}
+		}
+		return result;
+	}
+
+	T trace() const {
+		if (rows_ != cols_)
+			throw SizeMismatchException();
+		if constexpr (std::is_floating_point<T>::value) {
+			Accumulation policy = accumulation();
+			if (policy == Accumulation::Widened)
+				return T(detail::accumulate_sum<T, detail::WidenedType<T>>(policy, data_, cols_ + 1, rows_));
+			if (policy != Accumulation::Plain)
+				return detail::accumulate_sum<T, T>(policy, data_, cols_ + 1, rows_);
+		}
+		T result = T(0);
+		for (std::size_t i = 0; i < rows_; i++) {
+			result += data_[i*cols_ + i];
+		}
+		return result;
+	}
+
+	// Partial-pivoting elimination on a copy; integer matrices use
+	// fraction-free (Bareiss) elimination so the result stays exact.
+	T det() const {
+		if (rows_ != cols_)
+			throw SizeMismatchException();
+		std::size_t n = rows_;
+		BasicMatrix m(*this);
+		T sign = T(1);
+		T previous = T(1);
+		for (std::size_t k = 0; k < n; k++) {
+			std::size_t pivot = k;
+			for (std::size_t i = k + 1; i < n; i++) {
+				if (magnitude(m(i, k)) > magnitude(m(pivot, k)))
+					pivot = i;
+			}
+			if (m(pivot, k) == T(0))
+				return T(0);
+			if (pivot != k) {
+				std::swap_ranges(m.data_ + k*n, m.data_ + (k + 1)*n, m.data_ + pivot*n);
+				sign = -sign;
+			}
+			for (std::size_t i = k + 1; i < n; i++) {
+				if constexpr (std::is_floating_point<T>::value) {
+					T factor = m(i, k) / m(k, k);
+					for (std::size_t j = k + 1; j < n; j++) {
+						m(i, j) -= factor * m(k, j);
+					}
+				} else {
+					for (std::size_t j = k + 1; j < n; j++) {
+						m(i, j) = (m(i, j) * m(k, k) - m(i, k) * m(k, j)) / previous;
+					}
+				}
+			}
+			previous = m(k, k);
+		}
+		if constexpr (std::is_floating_point<T>::value) {
+			T result = sign;
+			for (std::size_t i = 0; i < n; i++) {
+				result *= m(i, i);
+			}
+			return result;
+		} else {
+			return n == 0 ? T(1) : sign * m(n - 1, n - 1);
+		}
+	}
+
+	bool operator==(const BasicMatrix& a) const {
+		if (rows_ != a.rows_ || cols_ != a.cols_)
+			return false;
+		for (std::size_t i = 0; i < rows_*cols_; i++) {
+			if constexpr (std::is_floating_point<T>::value) {
+				if (magnitude(data_[i] - a.data_[i]) > EPS)
+					return false;
+			} else if (data_[i] != a.data_[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool operator!=(const BasicMatrix& a) const {
+		return !(*this == a);
+	}
+
+private:
+	template <class Acc>
+	void accumulate_into(Accumulation policy, const BasicMatrix& a, BasicMatrix& result) const {
+		std::vector<Acc> work(detail::accumulation_workspace(policy, cols_) + detail::ACCUMULATION_COLUMNS);
+		detail::accumulate_product(policy, rows_, a.cols_, cols_, data_, cols_, a.data_, a.cols_,
+								   result.data_, a.cols_, work.data());
+	}
+
+	static T magnitude(const T& value) {
+		return value < T(0) ? -value : value;
+	}
+
+	void check_bounds(std::size_t row, std::size_t col) const {
+		if (row >= rows_ || col >= cols_)
+			throw OutOfBoundsException();
+	}
+
+	void check_same_shape(const BasicMatrix& a) const {
+		if (rows_ != a.rows_ || cols_ != a.cols_)
+			throw SizeMismatchException();
+	}
+
+	T* data_;
+	std::size_t rows_;
+	std::size_t cols_;
+};
+
+// The scalar is not deduced, so that 2.0 * m converts like m * 2.0.
+template <class T>
+BasicMatrix<T> operator*(const typename BasicMatrix<T>::value_type& number, const BasicMatrix<T>& matrix) {
+	return matrix * number;
+}
+
+using MatrixF = BasicMatrix<float>;
+using MatrixD = BasicMatrix<double>;
+using MatrixI64 = BasicMatrix<std::int64_t>;
+
+}  // namespace task
@@ -0,0 +1,140 @@
+#include "buffer_pool.h"
+#include <atomic>
+#include <new>
+
+using namespace task;
+
+namespace {
+
+// Buffers smaller than 2^(MAX_SHIFT + 1) doubles (128 MiB) are pooled, larger
+// ones go straight to the heap.
+const std::size_t MAX_SHIFT = 23;
+const std::size_t MIN_CAPACITY = BUFFER_ALIGNMENT / sizeof(double);
+const std::size_t CLASSES_PER_DOUBLING = 4;
+const std::size_t CLASS_COUNT = (MAX_SHIFT + 1) * CLASSES_PER_DOUBLING;
+const std::size_t SLOTS_PER_CLASS = 8;
+
+std::atomic<std::size_t> cached_bytes_limit(std::size_t(64) << 20);
+
+struct SizeClass {
+	std::size_t index;
+	std::size_t capacity;
+};
+
+std::size_t log2_floor(std::size_t value) {
+	return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(value);
+}
+
+// Classes are MIN_CAPACITY and then four equal steps between consecutive
+// powers of two.
+SizeClass size_class(std::size_t count) {
+	if (count <= MIN_CAPACITY)
+		return {0, MIN_CAPACITY};
+	std::size_t shift = log2_floor(count - 1);
+	std::size_t step = (std::size_t(1) << shift) / CLASSES_PER_DOUBLING;
+	std::size_t steps = (count + step - 1) / step;
+	return {shift * CLASSES_PER_DOUBLING + steps - CLASSES_PER_DOUBLING, steps * step};
+}
+
+// Inverse of size_class: the capacity of class index.
+std::size_t size_class_capacity(std::size_t index) {
+	if (index == 0)
+		return MIN_CAPACITY;
+	std::size_t shift = index / CLASSES_PER_DOUBLING;
+	std::size_t steps = index % CLASSES_PER_DOUBLING + CLASSES_PER_DOUBLING;
+	return ((std::size_t(1) << shift) / CLASSES_PER_DOUBLING) * steps;
+}
+
+double* heap_allocate(std::size_t capacity) {
+	return static_cast<double*>(::operator new(capacity * sizeof(double),
+											   std::align_val_t(BUFFER_ALIGNMENT)));
+}
+
+void heap_release(double* buffer) {
+	::operator delete(buffer, std::align_val_t(BUFFER_ALIGNMENT));
+}
+
+// Cleared when the thread's pool is destroyed, so that buffers released later
+// (by static matrices, for instance) go straight to the heap.
+thread_local bool pool_alive = false;
+
+struct Pool {
+	Pool() {
+		pool_alive = true;
+	}
+
+	double* slots[CLASS_COUNT][SLOTS_PER_CLASS] = {};
+	std::size_t used[CLASS_COUNT] = {};
+	BufferPoolStats stats = {};
+
+	// Frees cached buffers, the largest first, until at most limit bytes
+	// remain.
+	void trim(std::size_t limit) {
+		for (std::size_t i = CLASS_COUNT; i-- > 0 && stats.cached_bytes > limit;) {
+			while (used[i] > 0 && stats.cached_bytes > limit) {
+				double* buffer = slots[i][--used[i]];
+				stats.cached_bytes -= size_class_capacity(i) * sizeof(double);
+				heap_release(buffer);
+			}
+		}
+	}
+
+	~Pool() {
+		trim(0);
+		pool_alive = false;
+	}
+};
+
+thread_local Pool pool;
+
+}  // namespace
+
+BufferPoolStats task::buffer_pool_stats() {
+	return pool.stats;
+}
+
+void task::trim_buffer_pool() {
+	pool.trim(0);
+}
+
+void task::set_buffer_pool_limit(std::size_t bytes) {
+	cached_bytes_limit.store(bytes, std::memory_order_relaxed);
+	pool.trim(bytes);
+}
+
+std::size_t task::buffer_pool_limit() {
+	return cached_bytes_limit.load(std::memory_order_relaxed);
+}
+
+double* task::detail::allocate_buffer(std::size_t count, std::size_t& capacity) {
+	SizeClass cls = size_class(count);
+	capacity = cls.capacity;
+	if (cls.index >= CLASS_COUNT)
+		return heap_allocate(capacity);
+	if (pool.used[cls.index] > 0) {
+		pool.stats.hits++;
+		pool.stats.cached_bytes -= capacity * sizeof(double);
+		return pool.slots[cls.index][--pool.used[cls.index]];
+	}
+	pool.stats.misses++;
+	return heap_allocate(capacity);
+}
+
+void task::detail::release_buffer(double* buffer, std::size_t capacity) {
+	if (buffer == nullptr)
+		return;
+	SizeClass cls = size_class(capacity);
+	if (!pool_alive || cls.index >= CLASS_COUNT || cls.capacity != capacity ||
+		pool.used[cls.index] == SLOTS_PER_CLASS) {
+		heap_release(buffer);
+		return;
+	}
+	std::size_t limit = cached_bytes_limit.load(std::memory_order_relaxed);
+	if (pool.stats.cached_bytes + capacity * sizeof(double) > limit) {
+		pool.trim(limit);
+		heap_release(buffer);
+		return;
+	}
+	pool.slots[cls.index][pool.used[cls.index]++] = buffer;
+	pool.stats.cached_bytes += capacity * sizeof(double);
+}
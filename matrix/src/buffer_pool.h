@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+// Matrix element buffers are 64-byte (cache line) aligned and come from a
+// per-thread pool of size classes: four classes per power of two, so at most
+// a quarter of a buffer is slack. Released buffers are kept for reuse by
+// later temporaries of a similar size instead of going back to the heap.
+const std::size_t BUFFER_ALIGNMENT = 64;
+
+struct BufferPoolStats {
+	std::size_t hits;
+	std::size_t misses;
+	std::size_t cached_bytes;
+};
+
+// Counters of the calling thread's pool.
+BufferPoolStats buffer_pool_stats();
+
+// Returns the buffers cached by the calling thread to the heap.
+void trim_buffer_pool();
+
+// Most bytes each thread keeps cached, 64 MiB by default; buffers released
+// beyond it go back to the heap. Lowering the limit trims the calling
+// thread's pool right away and the other threads' pools as they release
+// buffers.
+void set_buffer_pool_limit(std::size_t bytes);
+std::size_t buffer_pool_limit();
+
+namespace detail {
+
+// Returns storage for at least count doubles and sets capacity to the number
+// of doubles it actually holds. The contents are uninitialized.
+double* allocate_buffer(std::size_t count, std::size_t& capacity);
+
+// Gives back a buffer from allocate_buffer together with its capacity.
+void release_buffer(double* buffer, std::size_t capacity);
+
+}  // namespace detail
+}  // namespace task
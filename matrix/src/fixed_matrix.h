@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "matrix.h"
+
+
+namespace task {
+
+// Matrix with the shape fixed at compile time, stored inline (no heap), for
+// the small transforms where a heap allocation per task::Matrix dominates.
+// Element-wise arithmetic is expanded over an index pack, so 3x3 and 4x4
+// operations compile to straight-line code, and everything is constexpr.
+template <class T, std::size_t R, std::size_t C>
+class FixedMatrix {
+public:
+	using value_type = T;
+
+	static constexpr std::size_t ROWS = R;
+	static constexpr std::size_t COLS = C;
+
+	// Ones on the main diagonal, zeros elsewhere, like task::Matrix.
+	constexpr FixedMatrix() : data_{} {
+		for (std::size_t i = 0; i < R && i < C; i++) {
+			data_[i*C + i] = T(1);
+		}
+	}
+
+	static constexpr FixedMatrix zero() {
+		FixedMatrix result;
+		for (std::size_t i = 0; i < R*C; i++) {
+			result.data_[i] = T(0);
+		}
+		return result;
+	}
+
+	static FixedMatrix from(const ConstMatrixView& matrix) {
+		if (matrix.rows() != R || matrix.cols() != C)
+			throw SizeMismatchException();
+		FixedMatrix result;
+		for (std::size_t i = 0; i < R; i++) {
+			for (std::size_t j = 0; j < C; j++) {
+				result.data_[i*C + j] = static_cast<T>(matrix(i, j));
+			}
+		}
+		return result;
+	}
+
+	Matrix to_matrix() const {
+		Matrix result(R, C, UNINITIALIZED);
+		for (std::size_t i = 0; i < R; i++) {
+			double* row = result.row_data(i);
+			for (std::size_t j = 0; j < C; j++) {
+				row[j] = static_cast<double>(data_[i*C + j]);
+			}
+		}
+		return result;
+	}
+
+	constexpr std::size_t rows() const {
+		return R;
+	}
+
+	constexpr std::size_t cols() const {
+		return C;
+	}
+
+	constexpr T& operator()(std::size_t row, std::size_t col) {
+		return data_[row*C + col];
+	}
+
+	constexpr const T& operator()(std::size_t row, std::size_t col) const {
+		return data_[row*C + col];
+	}
+
+	constexpr T* data() {
+		return data_;
+	}
+
+	constexpr const T* data() const {
+		return data_;
+	}
+
+	constexpr FixedMatrix& operator+=(const FixedMatrix& a) {
+		apply(a, [](T& x, const T& y) { x += y; }, std::make_index_sequence<R*C>());
+		return *this;
+	}
+
+	constexpr FixedMatrix& operator-=(const FixedMatrix& a) {
+		apply(a, [](T& x, const T& y) { x -= y; }, std::make_index_sequence<R*C>());
+		return *this;
+	}
+
+	constexpr FixedMatrix& operator*=(const T& number) {
+		scale(number, std::make_index_sequence<R*C>());
+		return *this;
+	}
+
+	constexpr FixedMatrix operator+(const FixedMatrix& a) const {
+		FixedMatrix result = *this;
+		return result += a;
+	}
+
+	constexpr FixedMatrix operator-(const FixedMatrix& a) const {
+		FixedMatrix result = *this;
+		return result -= a;
+	}
+
+	constexpr FixedMatrix operator*(const T& number) const {
+		FixedMatrix result = *this;
+		return result *= number;
+	}
+
+	constexpr FixedMatrix operator-() const {
+		return *this * T(-1);
+	}
+
+	constexpr FixedMatrix operator+() const {
+		return *this;
+	}
+
+	template <std::size_t K>
+	constexpr FixedMatrix<T, R, K> operator*(const FixedMatrix<T, C, K>& a) const {
+		FixedMatrix<T, R, K> result;
+		for (std::size_t i = 0; i < R; i++) {
+			for (std::size_t j = 0; j < K; j++) {
+				result(i, j) = dot(i, a, j, std::make_index_sequence<C>());
+			}
+		}
+		return result;
+	}
+
+	constexpr FixedMatrix<T, C, R> transposed() const {
+		FixedMatrix<T, C, R> result;
+		for (std::size_t i = 0; i < R; i++) {
+			for (std::size_t j = 0; j < C; j++) {
+				result(j, i) = data_[i*C + j];
+			}
+		}
+		return result;
+	}
+
+	constexpr T trace() const {
+		static_assert(R == C, "trace of a non-square matrix");
+		T result = T(0);
+		for (std::size_t i = 0; i < R; i++) {
+			result += data_[i*C + i];
+		}
+		return result;
+	}
+
+	// Closed form (cofactor expansion) up to 4x4, elimination above.
+	constexpr T det() const {
+		static_assert(R == C, "determinant of a non-square matrix");
+		const FixedMatrix& m = *this;
+		if constexpr (R == 1) {
+			return m(0, 0);
+		} else if constexpr (R == 2) {
+			return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+		} else if constexpr (R == 3) {
+			return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1))
+				 - m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0))
+				 + m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+		} else if constexpr (R == 4) {
+			// 2x2 minors of the two bottom rows.
+			T s01 = m(2, 0) * m(3, 1) - m(2, 1) * m(3, 0);
+			T s02 = m(2, 0) * m(3, 2) - m(2, 2) * m(3, 0);
+			T s03 = m(2, 0) * m(3, 3) - m(2, 3) * m(3, 0);
+			T s12 = m(2, 1) * m(3, 2) - m(2, 2) * m(3, 1);
+			T s13 = m(2, 1) * m(3, 3) - m(2, 3) * m(3, 1);
+			T s23 = m(2, 2) * m(3, 3) - m(2, 3) * m(3, 2);
+			return m(0, 0) * (m(1, 1) * s23 - m(1, 2) * s13 + m(1, 3) * s12)
+				 - m(0, 1) * (m(1, 0) * s23 - m(1, 2) * s03 + m(1, 3) * s02)
+				 + m(0, 2) * (m(1, 0) * s13 - m(1, 1) * s03 + m(1, 3) * s01)
+				 - m(0, 3) * (m(1, 0) * s12 - m(1, 1) * s02 + m(1, 2) * s01);
+		} else {
+			return eliminate();
+		}
+	}
+
+	constexpr bool operator==(const FixedMatrix& a) const {
+		for (std::size_t i = 0; i < R*C; i++) {
+			if constexpr (std::is_floating_point<T>::value) {
+				T diff = data_[i] - a.data_[i];
+				if (diff > EPS || -diff > EPS)
+					return false;
+			} else if (data_[i] != a.data_[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	constexpr bool operator!=(const FixedMatrix& a) const {
+		return !(*this == a);
+	}
+
+private:
+	template <class Op, std::size_t... I>
+	constexpr void apply(const FixedMatrix& a, Op op, std::index_sequence<I...>) {
+		(op(data_[I], a.data_[I]), ...);
+	}
+
+	template <std::size_t... I>
+	constexpr void scale(const T& number, std::index_sequence<I...>) {
+		((data_[I] *= number), ...);
+	}
+
+	template <std::size_t K, std::size_t... P>
+	constexpr T dot(std::size_t row, const FixedMatrix<T, C, K>& a, std::size_t col,
+					std::index_sequence<P...>) const {
+		return ((data_[row*C + P] * a(P, col)) + ...);
+	}
+
+	// Gaussian elimination with partial pivoting on a copy. Integer matrices
+	// use fraction-free (Bareiss) elimination so the result stays exact.
+	constexpr T eliminate() const {
+		FixedMatrix m = *this;
+		T sign = T(1);
+		T previous = T(1);
+		for (std::size_t k = 0; k < R; k++) {
+			std::size_t pivot = k;
+			for (std::size_t i = k + 1; i < R; i++) {
+				T candidate = m(i, k) < T(0) ? -m(i, k) : m(i, k);
+				T best = m(pivot, k) < T(0) ? -m(pivot, k) : m(pivot, k);
+				if (candidate > best)
+					pivot = i;
+			}
+			if (m(pivot, k) == T(0))
+				return T(0);
+			if (pivot != k) {
+				for (std::size_t j = 0; j < C; j++) {
+					T temp = m(k, j);
+					m(k, j) = m(pivot, j);
+					m(pivot, j) = temp;
+				}
+				sign = -sign;
+			}
+			for (std::size_t i = k + 1; i < R; i++) {
+				if constexpr (std::is_floating_point<T>::value) {
+					T factor = m(i, k) / m(k, k);
+					for (std::size_t j = k + 1; j < C; j++) {
+						m(i, j) -= factor * m(k, j);
+					}
+				} else {
+					for (std::size_t j = k + 1; j < C; j++) {
+						m(i, j) = (m(i, j) * m(k, k) - m(i, k) * m(k, j)) / previous;
+					}
+				}
+			}
+			if constexpr (!std::is_floating_point<T>::value) {
+				previous = m(k, k);
+			}
+		}
+		if constexpr (std::is_floating_point<T>::value) {
+			T result = sign;
+			for (std::size_t i = 0; i < R; i++) {
+				result *= m(i, i);
+			}
+			return result;
+		} else {
+			return sign * m(R - 1, R - 1);
+		}
+	}
+
+	T data_[R*C];
+};
+
+// The scalar is not deduced, so that 2.0 * m converts like m * 2.0.
+template <class T, std::size_t R, std::size_t C>
+constexpr FixedMatrix<T, R, C> operator*(const typename FixedMatrix<T, R, C>::value_type& number,
+										 const FixedMatrix<T, R, C>& matrix) {
+	return matrix * number;
+}
+
+using Matrix3f = FixedMatrix<float, 3, 3>;
+using Matrix4f = FixedMatrix<float, 4, 4>;
+using Matrix3d = FixedMatrix<double, 3, 3>;
+using Matrix4d = FixedMatrix<double, 4, 4>;
+
+}  // namespace task
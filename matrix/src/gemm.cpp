@@ -0,0 +1,149 @@
+#include "gemm.h"
+#include "buffer_pool.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Smallest number of multiply-adds worth handing to a thread in a product.
+const std::size_t GEMM_GRAIN = 1 << 20;
+
+// Packing buffer taken from the buffer pool, so repeated products of similar
+// sizes do not go back to the heap.
+class PackingBuffer {
+public:
+	explicit PackingBuffer(std::size_t count) : data_(task::detail::allocate_buffer(count, capacity_)) {}
+
+	PackingBuffer(const PackingBuffer&) = delete;
+	PackingBuffer& operator=(const PackingBuffer&) = delete;
+
+	~PackingBuffer() {
+		task::detail::release_buffer(data_, capacity_);
+	}
+
+	double* get() const {
+		return data_;
+	}
+
+private:
+	std::size_t capacity_;
+	double* data_;
+};
+
+// Register tile computed by the micro-kernel.
+const std::size_t MR = 4;
+const std::size_t NR = 8;
+
+// Cache blocking: a KC x NR sliver of B stays in L1, an MC x KC block of A
+// in L2 and a KC x NC panel of B in L3.
+const std::size_t KC = 256;
+const std::size_t MC = 96;
+const std::size_t NC = 2048;
+
+// Copies an mc x kc block of A into MR-row slivers laid out column by column,
+// padding the last sliver with zeros.
+void pack_a(std::size_t mc, std::size_t kc, const double* a, std::size_t lda,
+			double* packed) {
+	for (std::size_t i = 0; i < mc; i += MR) {
+		std::size_t rows = std::min(MR, mc - i);
+		for (std::size_t p = 0; p < kc; p++) {
+			for (std::size_t r = 0; r < rows; r++) {
+				packed[r] = a[(i + r)*lda + p];
+			}
+			for (std::size_t r = rows; r < MR; r++) {
+				packed[r] = 0;
+			}
+			packed += MR;
+		}
+	}
+}
+
+// Copies a kc x nc panel of B into NR-column slivers laid out row by row,
+// padding the last sliver with zeros.
+void pack_b(std::size_t kc, std::size_t nc, const double* b, std::size_t ldb,
+			double* packed) {
+	for (std::size_t j = 0; j < nc; j += NR) {
+		std::size_t cols = std::min(NR, nc - j);
+		for (std::size_t p = 0; p < kc; p++) {
+			const double* row = b + p*ldb + j;
+			for (std::size_t c = 0; c < cols; c++) {
+				packed[c] = row[c];
+			}
+			for (std::size_t c = cols; c < NR; c++) {
+				packed[c] = 0;
+			}
+			packed += NR;
+		}
+	}
+}
+
+// Accumulates the product of an MR-row sliver of A and an NR-column sliver of
+// B into an MR x NR tile of C. Only the top-left rows x cols part is written.
+void micro_kernel(std::size_t kc, const double* a, const double* b,
+				  double* c, std::size_t ldc, std::size_t rows, std::size_t cols) {
+	double acc[MR][NR] = {};
+	for (std::size_t p = 0; p < kc; p++) {
+		for (std::size_t r = 0; r < MR; r++) {
+			double a_rp = a[r];
+			for (std::size_t j = 0; j < NR; j++) {
+				acc[r][j] += a_rp * b[j];
+			}
+		}
+		a += MR;
+		b += NR;
+	}
+	for (std::size_t r = 0; r < rows; r++) {
+		for (std::size_t j = 0; j < cols; j++) {
+			c[r*ldc + j] += acc[r][j];
+		}
+	}
+}
+
+}  // namespace
+
+void task::detail::gemm(std::size_t m, std::size_t n, std::size_t k,
+						const double* a, std::size_t lda,
+						const double* b, std::size_t ldb,
+						double* c, std::size_t ldc) {
+	for (std::size_t i = 0; i < m; i++) {
+		std::memset(c + i*ldc, 0, n * sizeof(double));
+	}
+	if (m == 0 || n == 0 || k == 0)
+		return;
+
+	std::size_t nc_max = std::min(NC, (n + NR - 1) / NR * NR);
+	std::size_t mc_max = std::min(MC, (m + MR - 1) / MR * MR);
+	std::size_t kc_max = std::min(KC, k);
+	PackingBuffer packed_a(mc_max*kc_max);
+	PackingBuffer packed_b(kc_max*nc_max);
+
+	for (std::size_t jc = 0; jc < n; jc += NC) {
+		std::size_t nc = std::min(NC, n - jc);
+		for (std::size_t pc = 0; pc < k; pc += KC) {
+			std::size_t kc = std::min(KC, k - pc);
+			pack_b(kc, nc, b + pc*ldb + jc, ldb, packed_b.get());
+			for (std::size_t ic = 0; ic < m; ic += MC) {
+				std::size_t mc = std::min(MC, m - ic);
+				pack_a(mc, kc, a + ic*lda + pc, lda, packed_a.get());
+				for (std::size_t jr = 0; jr < nc; jr += NR) {
+					for (std::size_t ir = 0; ir < mc; ir += MR) {
+						micro_kernel(kc, packed_a.get() + ir*kc, packed_b.get() + jr*kc,
+									 c + (ic + ir)*ldc + jc + jr, ldc,
+									 std::min(MR, mc - ir), std::min(NR, nc - jr));
+					}
+				}
+			}
+		}
+	}
+}
+
+void task::detail::parallel_gemm(std::size_t m, std::size_t n, std::size_t k,
+								 const double* a, std::size_t lda,
+								 const double* b, std::size_t ldb,
+								 double* c, std::size_t ldc) {
+	std::size_t row_work = std::max<std::size_t>(n * k, 1);
+	parallel_for(m, GEMM_GRAIN / row_work + 1, [&](std::size_t begin, std::size_t end) {
+		gemm(end - begin, n, k, a + begin*lda, lda, b, ldb, c + begin*ldc, ldc);
+	});
+}
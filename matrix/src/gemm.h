@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+namespace detail {
+
+// C = A * B for row-major operands: A is m x k, B is k x n, C is m x n.
+// lda, ldb and ldc are the distances (in elements) between consecutive rows.
+// C is overwritten and must not alias A or B.
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+		  const double* a, std::size_t lda,
+		  const double* b, std::size_t ldb,
+		  double* c, std::size_t ldc);
+
+// gemm split into bands of rows over the thread pool. Every band uses the
+// same blocking, so the result does not depend on the number of threads.
+void parallel_gemm(std::size_t m, std::size_t n, std::size_t k,
+				   const double* a, std::size_t lda,
+				   const double* b, std::size_t ldb,
+				   double* c, std::size_t ldc);
+
+}  // namespace detail
+}  // namespace task
@@ -1,41 +1,130 @@
 #include "matrix.h"
+#include "accumulation.h"
+#include "gemm.h"
+#include "strassen.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "transpose.h"
+#include "buffer_pool.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 
 using namespace task;
 
-task::Matrix::Matrix() : rows_(1), cols_(1), data(new double[1]) {
-	data[0] = 1;
+namespace {
+
+// Smallest number of row updates worth handing to a thread in LU elimination.
+const std::size_t LU_GRAIN = 1 << 14;
+
+// Smallest number of multiply-adds worth handing to a thread in a triangular
+// solve; the right-hand sides are split into bands of columns.
+const std::size_t SOLVE_GRAIN = 1 << 16;
+
+// y += alpha * x
+void axpy(double* y, double alpha, const double* x, std::size_t n) {
+	for (std::size_t j = 0; j < n; j++) {
+		y[j] += alpha * x[j];
+	}
 }
 
-task::Matrix::Matrix(std::size_t rows, std::size_t cols) : rows_(rows),
-														   cols_(cols),
-														   data(new double[rows*cols]) {
-	for (int i = 0; i < rows_; i++) {
-		for (int j = 0; j < cols_; j++) {
-			if(i == j)
-				data[i*cols_ + j] = 1;
-			else
-				data[i*cols_ + j] = 0;
-		}
+void check_rhs(std::size_t n, const ConstMatrixView& b) {
+	if (b.rows() != n)
+		throw SizeMismatchException();
+}
+
+// Copies the n-element vector b into a new n x 1 matrix solved by solve and
+// back out again.
+template <class Solver>
+std::vector<double> solve_vector(const Solver& solver, const std::vector<double>& b) {
+	Matrix x = solver.solve(ConstMatrixView(b.data(), b.size(), 1, 1));
+	const double* data = x.view().data();
+	return std::vector<double>(data, data + b.size());
+}
+
+// Runs fn(begin, end) over bands of the k columns of an n x k right-hand
+// side. Substitution runs down the rows, so each band is independent.
+template <class Fn>
+void for_column_bands(std::size_t n, std::size_t k, const Fn& fn) {
+	detail::parallel_for(k, SOLVE_GRAIN / (n*n + 1) + 1, fn);
+}
+
+void add_parallel(const double* a, const double* b, double* out, std::size_t n) {
+	detail::parallel_for(n, detail::ELEMENTWISE_GRAIN, [&](std::size_t begin, std::size_t end) {
+		detail::add(a + begin, b + begin, out + begin, end - begin);
+	});
+}
+
+void subtract_parallel(const double* a, const double* b, double* out, std::size_t n) {
+	detail::parallel_for(n, detail::ELEMENTWISE_GRAIN, [&](std::size_t begin, std::size_t end) {
+		detail::subtract(a + begin, b + begin, out + begin, end - begin);
+	});
+}
+
+void negate_parallel(const double* a, double* out, std::size_t n) {
+	detail::parallel_for(n, detail::ELEMENTWISE_GRAIN, [&](std::size_t begin, std::size_t end) {
+		detail::negate(a + begin, out + begin, end - begin);
+	});
+}
+
+void scale_parallel(const double* a, double factor, double* out, std::size_t n) {
+	detail::parallel_for(n, detail::ELEMENTWISE_GRAIN, [&](std::size_t begin, std::size_t end) {
+		detail::scale(a + begin, factor, out + begin, end - begin);
+	});
+}
+
+}  // namespace
+
+task::Matrix::Matrix() : Matrix(1, 1) {}
+
+task::Matrix::Matrix(std::size_t rows, std::size_t cols) : Matrix(rows, cols, UNINITIALIZED) {
+	std::memset(data, 0, rows*cols * sizeof(double));
+	for (std::size_t i = 0; i < rows && i < cols; i++) {
+		data[i*cols + i] = 1;
 	}
 }
 
-task::Matrix::Matrix(const Matrix & copy) {
-	cols_ = copy.cols_;
-	rows_ = copy.rows_;
-	data = new double[cols_*rows_];
+task::Matrix::Matrix(std::size_t rows, std::size_t cols, Uninitialized) : rows_(rows), cols_(cols) {
+	data = detail::allocate_buffer(rows*cols, capacity_);
+}
+
+task::Matrix::Matrix(const Matrix & copy) : Matrix(copy.rows_, copy.cols_, UNINITIALIZED) {
 	std::memcpy(data, copy.data, sizeof(double)*cols_*rows_);
 }
 
+task::Matrix::Matrix(Matrix && other) noexcept : data(other.data),
+												  rows_(other.rows_),
+												  cols_(other.cols_),
+												  capacity_(other.capacity_) {
+	other.data = nullptr;
+	other.rows_ = 0;
+	other.cols_ = 0;
+	other.capacity_ = 0;
+}
+
+task::Matrix::~Matrix() {
+	detail::release_buffer(data, capacity_);
+}
+
 Matrix & task::Matrix::operator=(const Matrix & a) {
-	double* buffer = new double[a.rows()*a.cols()];
-	std::memcpy(buffer, a.data, a.rows() * a.cols() * sizeof(double));
-	delete[] data;
-	data = new double[a.rows()*a.cols()];
-	data = buffer;
-	rows_ = a.rows();
-	cols_ = a.cols();
+	if (this == &a)
+		return *this;
+	if (a.rows_*a.cols_ > capacity_) {
+		Matrix copy(a);
+		return *this = std::move(copy);
+	}
+	std::memcpy(data, a.data, a.rows_ * a.cols_ * sizeof(double));
+	rows_ = a.rows_;
+	cols_ = a.cols_;
+	return *this;
+}
+
+Matrix & task::Matrix::operator=(Matrix && a) noexcept {
+	std::swap(data, a.data);
+	std::swap(rows_, a.rows_);
+	std::swap(cols_, a.cols_);
+	std::swap(capacity_, a.capacity_);
 	return *this;
 }
 
@@ -64,174 +153,197 @@ void task::Matrix::set(size_t row, size_t col, const double & value) {
 }
 
 void task::Matrix::resize(size_t new_rows, size_t new_cols) {
-	double* buffer = new double[cols_*rows_];
-	memcpy(buffer, data, cols_*rows_ * sizeof(double));
-	delete [] data;
-	data = new double[new_rows*new_cols];
-	for (std::size_t i = 0; i < new_rows; i++) {
-		for (std::size_t j = 0; j < new_cols; j++) {
-			if (i < rows_ && j < cols_) {
-				data[i*new_cols + j] = buffer[i*cols_ + j];
-			} else {
-				data[i*new_cols + j] = 0;
-			}
-		}
+	std::size_t size = new_rows*new_cols;
+	if (size > capacity_) {
+		std::size_t capacity;
+		double* buffer = detail::allocate_buffer(std::max(size, 2*capacity_), capacity);
+		move_rows(data, buffer, new_rows, new_cols);
+		detail::release_buffer(data, capacity_);
+		data = buffer;
+		capacity_ = capacity;
+	} else {
+		move_rows(data, data, new_rows, new_cols);
 	}
-	cols_ = new_cols;
 	rows_ = new_rows;
-	delete [] buffer;
-}
-
-Vector task::Matrix::operator[](std::size_t row) {
-	return Vector(data+cols_*row, cols_);
+	cols_ = new_cols;
 }
 
-const Vector task::Matrix::operator[](std::size_t row) const {
-	return Vector(data+row*cols_, cols_);
+void task::Matrix::reserve(size_t elements) {
+	if (elements <= capacity_)
+		return;
+	std::size_t capacity;
+	double* buffer = detail::allocate_buffer(elements, capacity);
+	std::memcpy(buffer, data, rows_*cols_ * sizeof(double));
+	detail::release_buffer(data, capacity_);
+	data = buffer;
+	capacity_ = capacity;
+}
+
+// Lays the current rows out with a row length of new_cols in to, which is
+// either data itself or a fresh buffer, and zeroes the new elements. In place,
+// narrower rows move towards the front, so they go first to last; wider rows
+// move towards the back, so they go last to first.
+void task::Matrix::move_rows(const double* from, double* to, size_t new_rows, size_t new_cols) {
+	std::size_t rows = std::min(rows_, new_rows);
+	std::size_t cols = std::min(cols_, new_cols);
+	if (cols == cols_ && cols == new_cols) {
+		if (from != to)
+			std::memcpy(to, from, rows*cols * sizeof(double));
+	} else if (new_cols < cols_) {
+		for (std::size_t i = 0; i < rows; i++) {
+			std::memmove(to + i*new_cols, from + i*cols_, cols * sizeof(double));
+		}
+	} else {
+		for (std::size_t i = rows; i-- > 0;) {
+			std::memmove(to + i*new_cols, from + i*cols_, cols * sizeof(double));
+			std::memset(to + i*new_cols + cols, 0, (new_cols - cols) * sizeof(double));
+		}
+	}
+	std::memset(to + rows*new_cols, 0, (new_rows - rows)*new_cols * sizeof(double));
 }
 
 Matrix & task::Matrix::operator+=(const Matrix & a) {
 	if (cols_ != a.cols_ || rows_ != a.rows_)
 		throw SizeMismatchException();
-	Matrix result = *this + a;
-	*this = result;
+	add_parallel(data, a.data, data, rows_*cols_);
 	return *this;
 }
 
 Matrix & task::Matrix::operator-=(const Matrix & a) {
 	if (cols_ != a.cols_ || rows_ != a.rows_)
 		throw SizeMismatchException();
-	Matrix result = *this + (-a);
-	*this = result;
+	subtract_parallel(data, a.data, data, rows_*cols_);
 	return *this;
 }
 
 Matrix & task::Matrix::operator*=(const Matrix & a) {
 	if (cols_ != a.rows_)
 		throw SizeMismatchException();
-	Matrix result = *this * a;
-	*this = result;
+	*this = *this * a;
 	return *this;
 }
 
 Matrix & task::Matrix::operator*=(const double & number) {
-	Matrix result = *this * number;
-	*this = result;
+	scale_parallel(data, number, data, rows_*cols_);
 	return *this;
 }
 
-Matrix task::Matrix::operator+(const Matrix & a) const {
-	if (cols_ != a.cols_ || rows_ != a.rows_)
-		throw SizeMismatchException();
-
-	Matrix result(rows_, cols_);
-	for (int i = 0; i < result.rows_; i++) {
-		for (int j = 0; j < result.cols_; j++) {
-			result[i][j] = data[i*cols_ + j] + a[i][j];
-		}
-	}
-	return result;
+Matrix task::Matrix::operator+() const {
+	return Matrix(*this);
 }
 
-Matrix task::Matrix::operator-(const Matrix & a) const {
-	return *this + (-a);
+void task::multiply(const ConstMatrixView& a, const ConstMatrixView& b, const MatrixView& out) {
+	if (a.cols() != b.rows() || out.rows() != a.rows() || out.cols() != b.cols())
+		throw SizeMismatchException();
+	Accumulation policy = accumulation();
+	if (policy == Accumulation::Kahan || policy == Accumulation::Pairwise) {
+		detail::parallel_accumulate_product(policy, a.rows(), b.cols(), a.cols(), a.data(), a.ld(),
+											b.data(), b.ld(), out.data(), out.ld());
+		return;
+	}
+	if (product_algorithm() == ProductAlgorithm::Strassen) {
+		detail::strassen(a.rows(), b.cols(), a.cols(), a.data(), a.ld(), b.data(), b.ld(),
+						 out.data(), out.ld(), strassen_cutoff());
+		return;
+	}
+	detail::parallel_gemm(a.rows(), b.cols(), a.cols(), a.data(), a.ld(), b.data(), b.ld(),
+						  out.data(), out.ld());
 }
 
-Matrix task::Matrix::operator*(const Matrix & a) const {
-	if (cols_ != a.rows_)
+Matrix task::multiply(const ConstMatrixView& a, const ConstMatrixView& b) {
+	if (a.cols() != b.rows())
 		throw SizeMismatchException();
-
-	Matrix result(rows_, a.cols_);
-	for (int i = 0; i < result.rows_; i++) {
-		for (int j = 0; j < result.cols_; j++) {
-			result[i][j] = 0;
-			for (int k = 0; k < cols_; k++) {
-				result[i][j] += data[i*cols_ + k] * a[k][j];
-			}
-		}
-	}
+	Matrix result(a.rows(), b.cols(), UNINITIALIZED);
+	multiply(a, b, result);
 	return result;
 }
 
-Matrix task::Matrix::operator*(const double & a) const {
-	Matrix result(rows_, cols_);
-	for (int i = 0; i < result.rows_; i++) {
-		for (int j = 0; j < result.cols_; j++) {
-			result[i][j] = data[i*cols_ + j] * a;
-		}
-	}
-	return result;
+double task::Matrix::det() const {
+	return lu().det();
 }
 
-Matrix task::Matrix::operator-() const {
-	Matrix result(rows_, cols_);
-	for (int i = 0; i < result.rows_; i++) {
-		for (int j = 0; j < result.cols_; j++) {
-			result[i][j] = -data[i*cols_ + j];
-		}
-	}
-	return result;
+LU task::Matrix::lu() const {
+	return LU(*this);
 }
 
-Matrix task::Matrix::operator+() const {
-	return Matrix(*this);
+Cholesky task::Matrix::cholesky() const {
+	return Cholesky(*this);
 }
 
-double determinant(Matrix matrix, int n) {
-	double det = 0;
-	Matrix submatrix(matrix.rows(), matrix.cols());
-	if (n == 1) {
-		return matrix[0][0];
-	} else if (n == 2) {
-		return ((matrix[0][0] * matrix[1][1]) - (matrix[1][0] * matrix[0][1]));
-	} else {
-		for (int x = 0; x < n; x++) {
-			int subi = 0;
-			for (int i = 1; i < n; i++) {
-				int subj = 0;
-				for (int j = 0; j < n; j++) {
-					if (j == x)
-						continue;
-					submatrix[subi][subj] = matrix[i][j];
-					subj++;
-				}
-				subi++;
-			}
-			det = det + (pow(-1, x) * matrix[0][x] * determinant(submatrix, n - 1));
-		}
-	}
-	return det;
+Matrix task::Matrix::solve(const ConstMatrixView& b) const {
+	return lu().solve(b);
 }
 
-double task::Matrix::det() const {
-	if (cols_ != rows_)
-		throw SizeMismatchException();
-	return determinant(*this, cols_);
+std::vector<double> task::Matrix::solve(const std::vector<double>& b) const {
+	return lu().solve(b);
+}
+
+Matrix task::Matrix::inverse() const {
+	return lu().inverse();
 }
 
 void task::Matrix::transpose() {
-	Matrix tr = transposed();
-	*this = tr;
+	detail::transpose_in_place(data, rows_, cols_);
+	std::swap(rows_, cols_);
 }
 
 Matrix task::Matrix::transposed() const {
-	Matrix result(cols_, rows_);
-	for (int i = 0; i < rows_; i++) {
-		for (int j = 0; j < cols_; j++) {
-			result[j][i] = data[i*cols_ + j];
-		}
-	}
+	Matrix result(cols_, rows_, UNINITIALIZED);
+	std::size_t min_rows = detail::ELEMENTWISE_GRAIN / std::max<std::size_t>(cols_, 1) + 1;
+	detail::parallel_for(rows_, min_rows, [&](std::size_t begin, std::size_t end) {
+		detail::transpose(data + begin*cols_, end - begin, cols_, cols_,
+						  result.data + begin, rows_);
+	});
 	return result;
 }
 
 double task::Matrix::trace() const {
 	if (cols_ != rows_)
 		throw SizeMismatchException();
-	double result = 0;
-	for (std::size_t i = 0; i < cols_; i++) {
-		result += data[i*cols_ + i];
-	}
-	return result;
+	Accumulation policy = accumulation();
+	if (policy == Accumulation::Kahan || policy == Accumulation::Pairwise)
+		return detail::accumulate_sum<double, double>(policy, data, cols_ + 1, cols_);
+	return detail::trace(data, cols_);
+}
+
+MatrixView task::Matrix::view() {
+	return MatrixView(data, rows_, cols_, cols_);
+}
+
+ConstMatrixView task::Matrix::view() const {
+	return ConstMatrixView(data, rows_, cols_, cols_);
+}
+
+MatrixView task::Matrix::block(size_t row, size_t col, size_t rows, size_t cols) {
+	return view().block(row, col, rows, cols);
+}
+
+ConstMatrixView task::Matrix::block(size_t row, size_t col, size_t rows, size_t cols) const {
+	return view().block(row, col, rows, cols);
+}
+
+StridedVector task::Matrix::row_view(size_t row) {
+	if (row >= rows_)
+		throw OutOfBoundsException();
+	return view().row(row);
+}
+
+ConstStridedVector task::Matrix::row_view(size_t row) const {
+	if (row >= rows_)
+		throw OutOfBoundsException();
+	return view().row(row);
+}
+
+StridedVector task::Matrix::column_view(size_t column) {
+	if (column >= cols_)
+		throw OutOfBoundsException();
+	return view().column(column);
+}
+
+ConstStridedVector task::Matrix::column_view(size_t column) const {
+	if (column >= cols_)
+		throw OutOfBoundsException();
+	return view().column(column);
 }
 
 std::vector<double> task::Matrix::getRow(size_t row) {
@@ -247,54 +359,215 @@ std::vector<double> task::Matrix::getColumn(size_t column) {
 	return result;
 }
 
-bool task::Matrix::operator==(const Matrix & a) const {
-	if(cols_ != a.cols_ || rows_ != a.rows_)
-		return false;
-	for (std::size_t i = 0; i < cols_*rows_; i++) {
-		if (fabs(data[i]-a.data[i]) > EPS) {
-			return false;
+task::LU::LU(const Matrix& a) : factors_(a), perm_(a.rows()), sign_(1) {
+	if (a.rows() != a.cols())
+		throw SizeMismatchException();
+	std::size_t n = a.rows();
+	if (n == 0)
+		return;
+	double* lu = factors_.row_data(0);
+	for (std::size_t i = 0; i < n; i++) {
+		perm_[i] = i;
+	}
+	for (std::size_t k = 0; k < n; k++) {
+		std::size_t pivot = k;
+		for (std::size_t i = k + 1; i < n; i++) {
+			if (fabs(lu[i*n + k]) > fabs(lu[pivot*n + k]))
+				pivot = i;
+		}
+		if (pivot != k) {
+			std::swap_ranges(lu + k*n, lu + (k + 1)*n, lu + pivot*n);
+			std::swap(perm_[k], perm_[pivot]);
+			sign_ = -sign_;
 		}
+		double diag = lu[k*n + k];
+		if (diag == 0)
+			continue;
+		const double* row_k = lu + k*n;
+		std::size_t below = n - k - 1;
+		detail::parallel_for(below, LU_GRAIN / (below + 1) + 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = k + 1 + begin; i < k + 1 + end; i++) {
+				double* row_i = lu + i*n;
+				double factor = row_i[k] / diag;
+				row_i[k] = factor;
+				for (std::size_t j = k + 1; j < n; j++) {
+					row_i[j] -= factor * row_k[j];
+				}
+			}
+		});
+	}
+}
+
+double task::LU::det() const {
+	double result = sign_;
+	for (std::size_t i = 0; i < factors_.rows(); i++) {
+		result *= factors_.at_unchecked(i, i);
+	}
+	return result;
+}
+
+bool task::LU::singular() const {
+	for (std::size_t i = 0; i < factors_.rows(); i++) {
+		if (factors_.at_unchecked(i, i) == 0)
+			return true;
 	}
-	return true;
+	return false;
+}
+
+// Permutes the rows of B, then forward substitution with the unit lower
+// triangle and back substitution with the upper one.
+Matrix task::LU::solve(const ConstMatrixView& b) const {
+	std::size_t n = factors_.rows(), k = b.cols();
+	check_rhs(n, b);
+	if (singular())
+		throw SingularMatrixException();
+	Matrix result(n, k, UNINITIALIZED);
+	double* x = result.view().data();
+	for (std::size_t i = 0; i < n; i++) {
+		std::copy(b.data() + perm_[i]*b.ld(), b.data() + perm_[i]*b.ld() + k, x + i*k);
+	}
+	const double* lu = factors_.view().data();
+	for_column_bands(n, k, [&](std::size_t begin, std::size_t end) {
+		std::size_t width = end - begin;
+		for (std::size_t i = 0; i < n; i++) {
+			for (std::size_t j = 0; j < i; j++) {
+				axpy(x + i*k + begin, -lu[i*n + j], x + j*k + begin, width);
+			}
+		}
+		for (std::size_t i = n; i-- > 0;) {
+			double* row_i = x + i*k + begin;
+			for (std::size_t j = i + 1; j < n; j++) {
+				axpy(row_i, -lu[i*n + j], x + j*k + begin, width);
+			}
+			detail::scale(row_i, 1 / lu[i*n + i], row_i, width);
+		}
+	});
+	return result;
 }
 
-bool task::Matrix::operator!=(const Matrix & a) const {
-	return !(*this == a);
+std::vector<double> task::LU::solve(const std::vector<double>& b) const {
+	return solve_vector(*this, b);
 }
 
-task::Vector::Vector(double* ptr, std::size_t size) :
-vec_data(ptr), vec_size(size) {}
+Matrix task::LU::inverse() const {
+	return solve(Matrix(factors_.rows(), factors_.rows()));
+}
 
-double& task::Vector::operator[](std::size_t idx) {
-	if (idx < vec_size) {
-		return vec_data[idx];
-	} else {
-		throw std::out_of_range("");
+// Row-oriented: L[i][j] is a dot product of the first j elements of rows i
+// and j of L, both contiguous.
+task::Cholesky::Cholesky(const Matrix& a) : factor_(a.rows(), a.cols()) {
+	if (a.rows() != a.cols())
+		throw SizeMismatchException();
+	std::size_t n = a.rows();
+	if (n == 0)
+		return;
+	const double* source = a.view().data();
+	double* l = factor_.view().data();
+	for (std::size_t i = 0; i < n; i++) {
+		const double* row_i = l + i*n;
+		for (std::size_t j = 0; j <= i; j++) {
+			const double* row_j = l + j*n;
+			double sum = source[i*n + j];
+			for (std::size_t p = 0; p < j; p++) {
+				sum -= row_i[p] * row_j[p];
+			}
+			if (i == j) {
+				if (!(sum > 0))
+					throw NotPositiveDefiniteException();
+				l[i*n + i] = std::sqrt(sum);
+			} else {
+				l[i*n + j] = sum / row_j[j];
+			}
+		}
 	}
 }
 
-const double & task::Vector::operator[](std::size_t idx) const {
-	if (idx < vec_size) {
-		return vec_data[idx];
-	} else {
-		throw std::out_of_range("");
+double task::Cholesky::det() const {
+	double result = 1;
+	for (std::size_t i = 0; i < factor_.rows(); i++) {
+		result *= factor_.at_unchecked(i, i) * factor_.at_unchecked(i, i);
 	}
+	return result;
 }
 
-Matrix task::operator*(const double & a, const Matrix & b) {
-	Matrix result(b.rows(), b.cols());
-	for (int i = 0; i < result.rows(); i++) {
-		for (int j = 0; j < result.cols(); j++) {
-			result[i][j] = b[i][j] * a;
+// Forward substitution with L, then back substitution with L^T done by
+// columns of L^T, i.e. rows of L, so L is always read along its rows.
+Matrix task::Cholesky::solve(const ConstMatrixView& b) const {
+	std::size_t n = factor_.rows(), k = b.cols();
+	check_rhs(n, b);
+	Matrix result(n, k, UNINITIALIZED);
+	result.view() = b;
+	double* x = result.view().data();
+	const double* l = factor_.view().data();
+	for_column_bands(n, k, [&](std::size_t begin, std::size_t end) {
+		std::size_t width = end - begin;
+		for (std::size_t i = 0; i < n; i++) {
+			double* row_i = x + i*k + begin;
+			for (std::size_t j = 0; j < i; j++) {
+				axpy(row_i, -l[i*n + j], x + j*k + begin, width);
+			}
+			detail::scale(row_i, 1 / l[i*n + i], row_i, width);
 		}
-	}
+		for (std::size_t i = n; i-- > 0;) {
+			double* row_i = x + i*k + begin;
+			detail::scale(row_i, 1 / l[i*n + i], row_i, width);
+			for (std::size_t j = 0; j < i; j++) {
+				axpy(x + j*k + begin, -l[i*n + j], row_i, width);
+			}
+		}
+	});
 	return result;
 }
 
+std::vector<double> task::Cholesky::solve(const std::vector<double>& b) const {
+	return solve_vector(*this, b);
+}
+
+Matrix task::Cholesky::inverse() const {
+	return solve(Matrix(factor_.rows(), factor_.rows()));
+}
+
+void task::Matrix::evaluate(const MatrixSum<Matrix, Matrix>& expr, double* out) {
+	add_parallel(expr.lhs().data, expr.rhs().data, out, expr.rows()*expr.cols());
+}
+
+void task::Matrix::evaluate(const MatrixDifference<Matrix, Matrix>& expr, double* out) {
+	subtract_parallel(expr.lhs().data, expr.rhs().data, out, expr.rows()*expr.cols());
+}
+
+void task::Matrix::evaluate(const MatrixNegation<Matrix>& expr, double* out) {
+	negate_parallel(expr.operand().data, out, expr.rows()*expr.cols());
+}
+
+void task::Matrix::evaluate(const MatrixScaled<Matrix>& expr, double* out) {
+	scale_parallel(expr.operand().data, expr.factor(), out, expr.rows()*expr.cols());
+}
+
+bool task::Matrix::equal(const Matrix& lhs, const Matrix& rhs) {
+	if (lhs.rows_ != rhs.rows_ || lhs.cols_ != rhs.cols_)
+		return false;
+	std::atomic<bool> close(true);
+	detail::parallel_for(lhs.rows_*lhs.cols_, detail::ELEMENTWISE_GRAIN,
+						 [&](std::size_t begin, std::size_t end) {
+		if (!detail::all_close(lhs.data + begin, rhs.data + begin, end - begin, EPS))
+			close = false;
+	});
+	return close;
+}
+
+void task::detail::throw_size_mismatch() {
+	throw SizeMismatchException();
+}
+
+void task::detail::throw_out_of_bounds() {
+	throw OutOfBoundsException();
+}
+
 std::ostream & task::operator<<(std::ostream & output, const Matrix & matrix) {
 	for (std::size_t i = 0; i < matrix.rows(); i++) {
+		const double* row = matrix.row_data(i);
 		for (std::size_t j = 0; j < matrix.cols(); j++) {
-			output << matrix[i][j] << " ";
+			output << row[j] << " ";
 		}
 		output << "\n";
 	}
@@ -304,11 +577,12 @@ std::ostream & task::operator<<(std::ostream & output, const Matrix & matrix) {
 std::istream & task::operator>>(std::istream & input, Matrix & matrix) {
 	size_t cols, rows;
 	input >> rows >> cols;
-	matrix.resize(rows, cols);
-	for (std::size_t i = 0; i < rows; i++) {
-		for (std::size_t j = 0; j < cols; j++) {
-			input >> matrix[i][j];
-		}
+	if (!input)
+		return input;
+	if (matrix.rows() != rows || matrix.cols() != cols)
+		matrix = Matrix(rows, cols, UNINITIALIZED);
+	for (std::size_t i = 0; i < rows*cols; i++) {
+		input >> matrix.data[i];
 	}
 	return input;
 }
@@ -2,8 +2,27 @@
 
 #include <vector>
 #include <iostream>
+#include <string>
+#include <cmath>
+#include <stdexcept>
+#include "matrix_expr.h"
+#include "matrix_view.h"
+#include "buffer_pool.h"
+#include "thread_pool.h"
 
 
+// Bounds checks on the fast element paths (operator[], at_unchecked and
+// row_data) are a debug aid: on unless NDEBUG is defined, and can be forced
+// either way with -DTASK_MATRIX_BOUNDS_CHECK=0 or 1. get() and set() always
+// check.
+#ifndef TASK_MATRIX_BOUNDS_CHECK
+#ifdef NDEBUG
+#define TASK_MATRIX_BOUNDS_CHECK 0
+#else
+#define TASK_MATRIX_BOUNDS_CHECK 1
+#endif
+#endif
+
 namespace task {
 
 const double EPS = 1e-6;
@@ -11,46 +30,131 @@ const double EPS = 1e-6;
 
 class OutOfBoundsException : public std::exception {};
 class SizeMismatchException : public std::exception {};
+class SingularMatrixException : public std::exception {};
+class NotPositiveDefiniteException : public std::exception {};
 
 class Vector {
 public:
-	Vector(double* ptr, std::size_t size);
-	double& operator[](std::size_t idx);
-	const double& operator[](std::size_t idx) const;
+	Vector(double* ptr, std::size_t size) : vec_data(ptr), vec_size(size) {}
+
+	double& operator[](std::size_t idx) {
+		check(idx);
+		return vec_data[idx];
+	}
+
+	const double& operator[](std::size_t idx) const {
+		check(idx);
+		return vec_data[idx];
+	}
+
 	double* vec_data;
 private:
+	void check(std::size_t idx) const {
+#if TASK_MATRIX_BOUNDS_CHECK
+		if (idx >= vec_size)
+			throw std::out_of_range("");
+#endif
+	}
+
 	std::size_t vec_size;
 };
 
-class Matrix {
+class LU;
+class Cholesky;
+class MappedMatrix;
+
+// Constructor tag: allocate the elements but leave them uninitialized, for
+// callers that are about to overwrite all of them.
+struct Uninitialized {};
+const Uninitialized UNINITIALIZED{};
+
+class Matrix : public MatrixExpr<Matrix> {
 public:
     Matrix();
     Matrix(std::size_t rows, std::size_t cols);
+    Matrix(std::size_t rows, std::size_t cols, Uninitialized);
     Matrix(const Matrix& copy);
+    Matrix(Matrix&& other) noexcept;
+    template <class E>
+    Matrix(const MatrixExpr<E>& expr);
+    ~Matrix();
     Matrix& operator=(const Matrix& a);
+    Matrix& operator=(Matrix&& a) noexcept;
+    template <class E>
+    Matrix& operator=(const MatrixExpr<E>& expr);
 
     double& get(size_t row, size_t col);
     const double& get(size_t row, size_t col) const;
     void set(size_t row, size_t col, const double& value);
+    // Keeps the elements in the common top-left block and zeroes the rest.
+    // Like std::vector, the buffer is reused while the new shape fits in
+    // capacity() and grows geometrically otherwise.
     void resize(size_t new_rows, size_t new_cols);
+    // Makes room for at least elements doubles, so that resizing up to that
+    // many elements (e.g. appending rows one at a time) does not allocate.
+    void reserve(size_t elements);
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    Vector operator[](std::size_t row) {
+        check_row(row);
+        return Vector(data + row*cols_, cols_);
+    }
 
-    Vector operator[](std::size_t row);
-    const Vector operator[](std::size_t row) const;
+    const Vector operator[](std::size_t row) const {
+        check_row(row);
+        return Vector(data + row*cols_, cols_);
+    }
+
+    // Element access without the checks of get() and set(), for loops that
+    // already keep their indices in range. Only checked in debug builds, see
+    // TASK_MATRIX_BOUNDS_CHECK.
+    double& at_unchecked(size_t row, size_t col) {
+        check_bounds(row, col);
+        return data[row*cols_ + col];
+    }
+
+    const double& at_unchecked(size_t row, size_t col) const {
+        check_bounds(row, col);
+        return data[row*cols_ + col];
+    }
+
+    // Pointer to the cols() contiguous elements of a row. row_data(0) is the
+    // whole row-major buffer.
+    double* row_data(size_t row) {
+        check_row(row);
+        return data + row*cols_;
+    }
+
+    const double* row_data(size_t row) const {
+        check_row(row);
+        return data + row*cols_;
+    }
 
     Matrix& operator+=(const Matrix& a);
     Matrix& operator-=(const Matrix& a);
+    template <class E>
+    Matrix& operator+=(const MatrixExpr<E>& expr);
+    template <class E>
+    Matrix& operator-=(const MatrixExpr<E>& expr);
     Matrix& operator*=(const Matrix& a);
     Matrix& operator*=(const double& number);
 
-    Matrix operator+(const Matrix& a) const;
-    Matrix operator-(const Matrix& a) const;
-    Matrix operator*(const Matrix& a) const;
-    Matrix operator*(const double& a) const;
+    // Element-wise +, - and scalar * are lazy, see matrix_expr.h; the matrix
+    // product is a free operator below.
 
-    Matrix operator-() const;
     Matrix operator+() const;
 
     double det() const;
+    LU lu() const;
+    Cholesky cholesky() const;
+    // Solve A X = B column by column (A x = b for a vector) through a fresh
+    // LU factorization. Keep the LU object to solve again with the same A.
+    Matrix solve(const ConstMatrixView& b) const;
+    std::vector<double> solve(const std::vector<double>& b) const;
+    Matrix inverse() const;
     void transpose();
     Matrix transposed() const;
     double trace() const;
@@ -58,8 +162,28 @@ public:
     std::vector<double> getRow(size_t row);
     std::vector<double> getColumn(size_t column);
 
-    bool operator==(const Matrix& a) const;
-    bool operator!=(const Matrix& a) const;
+    // Views refer to the elements of this matrix without copying them and
+    // stay valid until the matrix is resized, reassigned or destroyed.
+    MatrixView view();
+    ConstMatrixView view() const;
+    MatrixView block(size_t row, size_t col, size_t rows, size_t cols);
+    ConstMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const;
+    StridedVector row_view(size_t row);
+    ConstStridedVector row_view(size_t row) const;
+    StridedVector column_view(size_t column);
+    ConstStridedVector column_view(size_t column) const;
+
+    // Maps a file written by write_binary or MatrixWriter (matrix_io.h)
+    // read-only, without parsing or copying the elements.
+    static MappedMatrix mmap_open(const std::string& path);
+
+    operator MatrixView() {
+        return view();
+    }
+
+    operator ConstMatrixView() const {
+        return view();
+    }
 
 	const std::size_t rows() const {
 		return rows_;
@@ -69,14 +193,324 @@ public:
 		return cols_;
 	}
 
+	double element(std::size_t row, std::size_t col) const {
+		return data[row*cols_ + col];
+	}
+
+	// Evaluates expr into out. Overloads for single-operation expressions over
+	// matrices run the vectorized kernels from simd.h.
+	template <class E>
+	static void evaluate(const E& expr, double* out);
+	static void evaluate(const MatrixSum<Matrix, Matrix>& expr, double* out);
+	static void evaluate(const MatrixDifference<Matrix, Matrix>& expr, double* out);
+	static void evaluate(const MatrixNegation<Matrix>& expr, double* out);
+	static void evaluate(const MatrixScaled<Matrix>& expr, double* out);
+
+	template <class L, class R>
+	static bool equal(const L& lhs, const R& rhs);
+	static bool equal(const Matrix& lhs, const Matrix& rhs);
+
 private:
+	friend std::istream& operator>>(std::istream& input, Matrix& matrix);
+
+	void move_rows(const double* from, double* to, size_t new_rows, size_t new_cols);
+
+	void check_bounds(size_t row, size_t col) const {
+#if TASK_MATRIX_BOUNDS_CHECK
+		if (row >= rows_ || col >= cols_)
+			detail::throw_out_of_bounds();
+#endif
+	}
+
+	void check_row(size_t row) const {
+#if TASK_MATRIX_BOUNDS_CHECK
+		if (row >= rows_)
+			detail::throw_out_of_bounds();
+#endif
+	}
+
 	double* data;
 	std::size_t rows_;
 	std::size_t cols_;
+	std::size_t capacity_;
+};
+
+
+// LU factorization with partial pivoting: P * A = L * U.
+// L (with unit diagonal, not stored) and U are packed into one square matrix,
+// row i of P * A is row permutation()[i] of A.
+class LU {
+public:
+	explicit LU(const Matrix& a);
+
+	double det() const;
+	bool singular() const;
+
+	// X with A X = B for an n x k matrix B of right-hand sides; throws
+	// SingularMatrixException if A is singular.
+	Matrix solve(const ConstMatrixView& b) const;
+	std::vector<double> solve(const std::vector<double>& b) const;
+	Matrix inverse() const;
+
+	const Matrix& factors() const {
+		return factors_;
+	}
+
+	const std::vector<std::size_t>& permutation() const {
+		return perm_;
+	}
+
+private:
+	Matrix factors_;
+	std::vector<std::size_t> perm_;
+	int sign_;
+};
+
+
+// Cholesky factorization of a symmetric positive definite matrix: A = L * L^T
+// with L lower triangular. Only the lower triangle of A is read. About half
+// the work of LU and no pivoting; throws NotPositiveDefiniteException.
+class Cholesky {
+public:
+	explicit Cholesky(const Matrix& a);
+
+	double det() const;
+
+	Matrix solve(const ConstMatrixView& b) const;
+	std::vector<double> solve(const std::vector<double>& b) const;
+	Matrix inverse() const;
+
+	// L, with zeros above the diagonal.
+	const Matrix& factor() const {
+		return factor_;
+	}
+
+private:
+	Matrix factor_;
 };
 
 
-Matrix operator*(const double& a, const Matrix& b);
+template <class E>
+Matrix MatrixExpr<E>::eval() const {
+	return Matrix(*this);
+}
+
+template <class E>
+std::vector<double> MatrixExpr<E>::operator[](std::size_t row) const {
+	if (row >= rows())
+		detail::throw_out_of_bounds();
+	std::vector<double> result(cols());
+	for (std::size_t j = 0; j < cols(); j++) {
+		result[j] = element(row, j);
+	}
+	return result;
+}
+
+template <class E>
+double MatrixExpr<E>::det() const {
+	return eval().det();
+}
+
+template <class E>
+LU MatrixExpr<E>::lu() const {
+	return LU(eval());
+}
+
+template <class E>
+Cholesky MatrixExpr<E>::cholesky() const {
+	return Cholesky(eval());
+}
+
+template <class E>
+Matrix MatrixExpr<E>::inverse() const {
+	return eval().inverse();
+}
+
+template <class E>
+Matrix MatrixExpr<E>::transposed() const {
+	return eval().transposed();
+}
+
+template <class E>
+double MatrixExpr<E>::trace() const {
+	return eval().trace();
+}
+
+template <class E>
+std::vector<double> MatrixExpr<E>::getRow(std::size_t row) const {
+	return (*this)[row];
+}
+
+template <class E>
+std::vector<double> MatrixExpr<E>::getColumn(std::size_t column) const {
+	return eval().getColumn(column);
+}
+
+template <class E>
+Matrix::Matrix(const MatrixExpr<E>& expr) : Matrix(expr.rows(), expr.cols(), UNINITIALIZED) {
+	evaluate(expr.self(), data);
+}
+
+// Every node reads only the element it produces, so the expression may refer
+// to *this.
+template <class E>
+Matrix& Matrix::operator=(const MatrixExpr<E>& expr) {
+	std::size_t rows = expr.rows(), cols = expr.cols();
+	if (rows*cols != rows_*cols_) {
+		Matrix result(expr);
+		return *this = std::move(result);
+	}
+	evaluate(expr.self(), data);
+	rows_ = rows;
+	cols_ = cols;
+	return *this;
+}
+
+template <class E>
+Matrix& Matrix::operator+=(const MatrixExpr<E>& expr) {
+	if (cols_ != expr.cols() || rows_ != expr.rows())
+		throw SizeMismatchException();
+	for (std::size_t i = 0; i < rows_; i++) {
+		for (std::size_t j = 0; j < cols_; j++) {
+			data[i*cols_ + j] += expr.element(i, j);
+		}
+	}
+	return *this;
+}
+
+template <class E>
+Matrix& Matrix::operator-=(const MatrixExpr<E>& expr) {
+	if (cols_ != expr.cols() || rows_ != expr.rows())
+		throw SizeMismatchException();
+	for (std::size_t i = 0; i < rows_; i++) {
+		for (std::size_t j = 0; j < cols_; j++) {
+			data[i*cols_ + j] -= expr.element(i, j);
+		}
+	}
+	return *this;
+}
+
+template <class E>
+void Matrix::evaluate(const E& expr, double* out) {
+	detail::parallel_for(expr.rows()*expr.cols(), detail::ELEMENTWISE_GRAIN,
+						 [&](std::size_t begin, std::size_t end) {
+		detail::for_each_element(begin, end, expr.cols(), [&](std::size_t idx, std::size_t row, std::size_t col) {
+			out[idx] = expr.element(row, col);
+		});
+	});
+}
+
+template <class L, class R>
+bool Matrix::equal(const L& lhs, const R& rhs) {
+	if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+		return false;
+	for (std::size_t i = 0; i < lhs.rows(); i++) {
+		for (std::size_t j = 0; j < lhs.cols(); j++) {
+			if (std::fabs(lhs.element(i, j) - rhs.element(i, j)) > EPS)
+				return false;
+		}
+	}
+	return true;
+}
+
+// out = a * b; out must not overlap a or b. The product (like trace()) sums
+// its terms according to task::accumulation(), see accumulation.h.
+void multiply(const ConstMatrixView& a, const ConstMatrixView& b, const MatrixView& out);
+Matrix multiply(const ConstMatrixView& a, const ConstMatrixView& b);
+
+namespace detail {
+
+// Matrices and views are multiplied in place, other expressions are
+// evaluated into storage first.
+template <class E>
+ConstMatrixView product_operand(const E& expr, Matrix& storage) {
+	if constexpr (std::is_same<E, Matrix>::value || std::is_same<E, MatrixView>::value ||
+				  std::is_same<E, ConstMatrixView>::value) {
+		return expr;
+	} else {
+		storage = expr;
+		return storage;
+	}
+}
+
+}  // namespace detail
+
+template <class L, class R>
+Matrix operator*(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+	Matrix lhs_storage, rhs_storage;
+	return multiply(detail::product_operand(lhs.self(), lhs_storage),
+					detail::product_operand(rhs.self(), rhs_storage));
+}
+
+// Matrix-vector product, with the vector as a column.
+template <class L, class T>
+std::vector<double> operator*(const MatrixExpr<L>& lhs, const BasicStridedVector<T>& rhs) {
+	Matrix lhs_storage;
+	return multiply(detail::product_operand(lhs.self(), lhs_storage), rhs.as_column()).getColumn(0);
+}
+
+// A temporary Matrix operand would not outlive an expression kept in an auto
+// variable, so these overloads evaluate right away, into its buffer, and
+// return a Matrix.
+template <class R>
+Matrix operator+(Matrix&& lhs, const MatrixExpr<R>& rhs) {
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+template <class L>
+Matrix operator+(const MatrixExpr<L>& lhs, Matrix&& rhs) {
+	rhs += lhs;
+	return std::move(rhs);
+}
+
+inline Matrix operator+(Matrix&& lhs, Matrix&& rhs) {
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+template <class R>
+Matrix operator-(Matrix&& lhs, const MatrixExpr<R>& rhs) {
+	lhs -= rhs;
+	return std::move(lhs);
+}
+
+template <class L>
+Matrix operator-(const MatrixExpr<L>& lhs, Matrix&& rhs) {
+	rhs = MatrixDifference<L, Matrix>(lhs.self(), rhs);
+	return std::move(rhs);
+}
+
+inline Matrix operator-(Matrix&& lhs, Matrix&& rhs) {
+	lhs -= rhs;
+	return std::move(lhs);
+}
+
+inline Matrix operator-(Matrix&& operand) {
+	operand = MatrixNegation<Matrix>(operand);
+	return std::move(operand);
+}
+
+inline Matrix operator*(Matrix&& operand, const double& factor) {
+	operand *= factor;
+	return std::move(operand);
+}
+
+inline Matrix operator*(const double& factor, Matrix&& operand) {
+	operand *= factor;
+	return std::move(operand);
+}
+
+template <class L, class R>
+bool operator==(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+	return Matrix::equal(lhs.self(), rhs.self());
+}
+
+template <class L, class R>
+bool operator!=(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+	return !(lhs == rhs);
+}
+
 
 std::ostream& operator<<(std::ostream& output, const Matrix& matrix);
 std::istream& operator>>(std::istream& input, Matrix& matrix);
@@ -84,3 +518,6 @@ std::istream& operator>>(std::istream& input, Matrix& matrix);
 
 
 }  // namespace task
+
+
+#include "matrix_io.h"
@@ -0,0 +1,315 @@
+#include "matrix_batch.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_SIMD_X86
+#endif
+
+using namespace task;
+
+namespace {
+
+const std::size_t LANES = MatrixBatch::LANES;
+
+// The kernels handle the groups [begin, end). The product is written once and
+// compiled for the baseline and for AVX2, where the fixed LANES-wide inner
+// loops become 256-bit vector code.
+inline __attribute__((always_inline))
+void multiply_groups(std::size_t m, std::size_t n, std::size_t k,
+					 const double* a, const double* b, double* out,
+					 std::size_t begin, std::size_t end) {
+	for (std::size_t group = begin; group < end; group++) {
+		const double* x = a + group*m*k*LANES;
+		const double* y = b + group*k*n*LANES;
+		double* z = out + group*m*n*LANES;
+		for (std::size_t i = 0; i < m; i++) {
+			for (std::size_t j = 0; j < n; j++) {
+				double acc[LANES] = {};
+				for (std::size_t p = 0; p < k; p++) {
+					const double* x_ip = x + (i*k + p)*LANES;
+					const double* y_pj = y + (p*n + j)*LANES;
+					for (std::size_t l = 0; l < LANES; l++) {
+						acc[l] += x_ip[l] * y_pj[l];
+					}
+				}
+				std::memcpy(z + (i*n + j)*LANES, acc, sizeof(acc));
+			}
+		}
+	}
+}
+
+// Gaussian elimination with partial pivoting in every lane at once, on a
+// copy of the group. Each lane picks its own pivot row; only the row swaps
+// are done lane by lane, the elimination is shared. There is no AVX2 build
+// of it: the per-lane swaps feed vector loads, and the wider version
+// measured no faster.
+void det_groups(std::size_t n, const double* a, double* out, double* work,
+				std::size_t begin, std::size_t end) {
+	for (std::size_t group = begin; group < end; group++) {
+		std::memcpy(work, a + group*n*n*LANES, n*n*LANES * sizeof(double));
+		double result[LANES];
+		for (std::size_t l = 0; l < LANES; l++) {
+			result[l] = 1;
+		}
+		for (std::size_t k = 0; k < n; k++) {
+			// Row indices are kept as doubles so that the search compiles to
+			// compares and blends of one vector type.
+			double pivot[LANES];
+			double best[LANES];
+			for (std::size_t l = 0; l < LANES; l++) {
+				pivot[l] = double(k);
+				best[l] = std::fabs(work[(k*n + k)*LANES + l]);
+			}
+			for (std::size_t i = k + 1; i < n; i++) {
+				for (std::size_t l = 0; l < LANES; l++) {
+					double value = std::fabs(work[(i*n + k)*LANES + l]);
+					bool larger = value > best[l];
+					pivot[l] = larger ? double(i) : pivot[l];
+					best[l] = larger ? value : best[l];
+				}
+			}
+			for (std::size_t l = 0; l < LANES; l++) {
+				std::size_t row = std::size_t(pivot[l]);
+				if (row == k)
+					continue;
+				for (std::size_t j = k; j < n; j++) {
+					std::swap(work[(k*n + j)*LANES + l], work[(row*n + j)*LANES + l]);
+				}
+				result[l] = -result[l];
+			}
+			// A zero pivot makes the determinant zero; its inverse is taken
+			// as zero so that the lane carries on without producing NaNs.
+			double inverse[LANES];
+			for (std::size_t l = 0; l < LANES; l++) {
+				double diag = work[(k*n + k)*LANES + l];
+				result[l] *= diag;
+				inverse[l] = diag != 0 ? 1 / diag : 0;
+			}
+			for (std::size_t i = k + 1; i < n; i++) {
+				double factor[LANES];
+				for (std::size_t l = 0; l < LANES; l++) {
+					factor[l] = work[(i*n + k)*LANES + l] * inverse[l];
+				}
+				for (std::size_t j = k + 1; j < n; j++) {
+					// A local copy tells the compiler the rows do not overlap.
+					double pivot_row[LANES];
+					std::memcpy(pivot_row, work + (k*n + j)*LANES, sizeof(pivot_row));
+					double* row_i = work + (i*n + j)*LANES;
+					for (std::size_t l = 0; l < LANES; l++) {
+						row_i[l] -= factor[l] * pivot_row[l];
+					}
+				}
+			}
+		}
+		std::memcpy(out + group*LANES, result, sizeof(result));
+	}
+}
+
+void multiply_baseline(std::size_t m, std::size_t n, std::size_t k, const double* a, const double* b,
+					   double* out, std::size_t begin, std::size_t end) {
+	multiply_groups(m, n, k, a, b, out, begin, end);
+}
+
+#ifdef TASK_SIMD_X86
+
+__attribute__((target("avx2")))
+void multiply_avx2(std::size_t m, std::size_t n, std::size_t k, const double* a, const double* b,
+				   double* out, std::size_t begin, std::size_t end) {
+	multiply_groups(m, n, k, a, b, out, begin, end);
+}
+
+#endif
+
+using MultiplyKernel = void (*)(std::size_t, std::size_t, std::size_t, const double*, const double*,
+							   double*, std::size_t, std::size_t);
+
+MultiplyKernel multiply_kernel() {
+#ifdef TASK_SIMD_X86
+	if (simd_level() == SimdLevel::AVX2)
+		return multiply_avx2;
+#endif
+	return multiply_baseline;
+}
+
+// Groups per thread such that a chunk covers about ELEMENTWISE_GRAIN
+// multiply-adds.
+std::size_t min_groups(std::size_t work_per_matrix) {
+	return detail::ELEMENTWISE_GRAIN / (std::max<std::size_t>(work_per_matrix, 1) * LANES) + 1;
+}
+
+}  // namespace
+
+task::MatrixBatch::MatrixBatch(std::size_t count, std::size_t rows, std::size_t cols)
+		: MatrixBatch(count, rows, cols, UNINITIALIZED) {
+	std::fill(data_, data_ + groups_*rows*cols*LANES, 0.);
+	for (std::size_t index = 0; index < count; index++) {
+		for (std::size_t i = 0; i < rows && i < cols; i++) {
+			(*this)(index, i, i) = 1;
+		}
+	}
+}
+
+// The padding matrices of the last group are zeroed even here, so the
+// kernels, which run over them as well, never read indeterminate values.
+task::MatrixBatch::MatrixBatch(std::size_t count, std::size_t rows, std::size_t cols, Uninitialized)
+		: count_(count), groups_((count + LANES - 1) / LANES), rows_(rows), cols_(cols) {
+	data_ = detail::allocate_buffer(groups_*rows*cols*LANES, capacity_);
+	for (std::size_t index = count; index < groups_*LANES; index++) {
+		for (std::size_t e = 0; e < rows*cols; e++) {
+			data_[offset(index, 0, e)] = 0;
+		}
+	}
+}
+
+task::MatrixBatch::MatrixBatch(const MatrixBatch& copy)
+		: MatrixBatch(copy.count_, copy.rows_, copy.cols_, UNINITIALIZED) {
+	std::memcpy(data_, copy.data_, groups_*rows_*cols_*LANES * sizeof(double));
+}
+
+task::MatrixBatch::MatrixBatch(MatrixBatch&& other) noexcept : data_(other.data_),
+															   count_(other.count_),
+															   groups_(other.groups_),
+															   rows_(other.rows_),
+															   cols_(other.cols_),
+															   capacity_(other.capacity_) {
+	other.data_ = nullptr;
+	other.count_ = 0;
+	other.groups_ = 0;
+	other.rows_ = 0;
+	other.cols_ = 0;
+	other.capacity_ = 0;
+}
+
+task::MatrixBatch::~MatrixBatch() {
+	detail::release_buffer(data_, capacity_);
+}
+
+MatrixBatch& task::MatrixBatch::operator=(const MatrixBatch& a) {
+	if (this == &a)
+		return *this;
+	std::size_t size = a.groups_*a.rows_*a.cols_*LANES;
+	if (size > capacity_) {
+		MatrixBatch copy(a);
+		return *this = std::move(copy);
+	}
+	std::memcpy(data_, a.data_, size * sizeof(double));
+	count_ = a.count_;
+	groups_ = a.groups_;
+	rows_ = a.rows_;
+	cols_ = a.cols_;
+	return *this;
+}
+
+MatrixBatch& task::MatrixBatch::operator=(MatrixBatch&& a) noexcept {
+	std::swap(data_, a.data_);
+	std::swap(count_, a.count_);
+	std::swap(groups_, a.groups_);
+	std::swap(rows_, a.rows_);
+	std::swap(cols_, a.cols_);
+	std::swap(capacity_, a.capacity_);
+	return *this;
+}
+
+Matrix task::MatrixBatch::get(std::size_t index) const {
+	if (index >= count_)
+		throw OutOfBoundsException();
+	Matrix result(rows_, cols_, UNINITIALIZED);
+	double* out = result.view().data();
+	for (std::size_t e = 0; e < rows_*cols_; e++) {
+		out[e] = data_[offset(index, 0, e)];
+	}
+	return result;
+}
+
+void task::MatrixBatch::set(std::size_t index, const ConstMatrixView& matrix) {
+	if (index >= count_)
+		throw OutOfBoundsException();
+	if (matrix.rows() != rows_ || matrix.cols() != cols_)
+		throw SizeMismatchException();
+	for (std::size_t i = 0; i < rows_; i++) {
+		for (std::size_t j = 0; j < cols_; j++) {
+			(*this)(index, i, j) = matrix(i, j);
+		}
+	}
+}
+
+// Transposing only moves whole cache lines of LANES elements around.
+MatrixBatch task::MatrixBatch::transposed() const {
+	MatrixBatch result(count_, cols_, rows_, UNINITIALIZED);
+	for (std::size_t g = 0; g < groups_; g++) {
+		const double* in = group(g);
+		double* out = result.group(g);
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				std::memcpy(out + (j*rows_ + i)*LANES, in + (i*cols_ + j)*LANES, LANES * sizeof(double));
+			}
+		}
+	}
+	return result;
+}
+
+void task::MatrixBatch::trace(double* out) const {
+	if (rows_ != cols_)
+		throw SizeMismatchException();
+	for (std::size_t g = 0; g < groups_; g++) {
+		double sum[LANES] = {};
+		for (std::size_t i = 0; i < rows_; i++) {
+			detail::add(sum, group(g) + (i*cols_ + i)*LANES, sum, LANES);
+		}
+		std::copy(sum, sum + std::min(LANES, count_ - g*LANES), out + g*LANES);
+	}
+}
+
+std::vector<double> task::MatrixBatch::trace() const {
+	std::vector<double> result(count_);
+	trace(result.data());
+	return result;
+}
+
+void task::MatrixBatch::det(double* out) const {
+	if (rows_ != cols_)
+		throw SizeMismatchException();
+	std::size_t n = rows_;
+	// The kernel writes whole groups, so the padding goes to a buffer of
+	// groups() * LANES results.
+	std::size_t results_capacity;
+	double* results = detail::allocate_buffer(groups_*LANES, results_capacity);
+	detail::parallel_for(groups_, min_groups(n*n*n / 3), [&](std::size_t begin, std::size_t end) {
+		std::size_t work_capacity;
+		double* work = detail::allocate_buffer(n*n*LANES, work_capacity);
+		det_groups(n, data_, results, work, begin, end);
+		detail::release_buffer(work, work_capacity);
+	});
+	std::memcpy(out, results, count_ * sizeof(double));
+	detail::release_buffer(results, results_capacity);
+}
+
+std::vector<double> task::MatrixBatch::det() const {
+	std::vector<double> result(count_);
+	det(result.data());
+	return result;
+}
+
+void task::multiply(const MatrixBatch& a, const MatrixBatch& b, MatrixBatch& out) {
+	if (a.count() != b.count() || a.cols() != b.rows() || out.count() != a.count() ||
+		out.rows() != a.rows() || out.cols() != b.cols())
+		throw SizeMismatchException();
+	std::size_t m = a.rows(), n = b.cols(), k = a.cols();
+	MultiplyKernel kernel = multiply_kernel();
+	const double* x = a.group(0);
+	const double* y = b.group(0);
+	double* z = out.group(0);
+	detail::parallel_for(a.groups(), min_groups(m*n*k), [&](std::size_t begin, std::size_t end) {
+		kernel(m, n, k, x, y, z, begin, end);
+	});
+}
+
+MatrixBatch task::operator*(const MatrixBatch& a, const MatrixBatch& b) {
+	MatrixBatch result(a.count(), a.rows(), b.cols(), UNINITIALIZED);
+	multiply(a, b, result);
+	return result;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "matrix.h"
+
+
+namespace task {
+
+// count() matrices of the same shape stored element-interleaved: the matrices
+// form groups of LANES, and a group stores element (row, col) of its LANES
+// matrices next to each other (a cache line), then the next element, and so
+// on. The kernels work on a group at a time, so the arithmetic is vectorized
+// across the matrices rather than within one of them, which is what pays off
+// for many 4x4 to 16x16 matrices, while every group stays contiguous. The
+// last group is padded with zero matrices.
+class MatrixBatch {
+public:
+	static constexpr std::size_t LANES = 8;
+
+	// Every matrix is the identity, like task::Matrix.
+	MatrixBatch(std::size_t count, std::size_t rows, std::size_t cols);
+	MatrixBatch(std::size_t count, std::size_t rows, std::size_t cols, Uninitialized);
+	MatrixBatch(const MatrixBatch& copy);
+	MatrixBatch(MatrixBatch&& other) noexcept;
+	~MatrixBatch();
+	MatrixBatch& operator=(const MatrixBatch& a);
+	MatrixBatch& operator=(MatrixBatch&& a) noexcept;
+
+	std::size_t count() const {
+		return count_;
+	}
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+	std::size_t groups() const {
+		return groups_;
+	}
+
+	// Element (row, col) of matrix index, unchecked.
+	double& operator()(std::size_t index, std::size_t row, std::size_t col) {
+		return data_[offset(index, row, col)];
+	}
+
+	double operator()(std::size_t index, std::size_t row, std::size_t col) const {
+		return data_[offset(index, row, col)];
+	}
+
+	// The rows() * cols() * LANES elements of a group.
+	double* group(std::size_t group) {
+		return data_ + group*rows_*cols_*LANES;
+	}
+
+	const double* group(std::size_t group) const {
+		return data_ + group*rows_*cols_*LANES;
+	}
+
+	// Copies matrix index out of / into the batch; throw OutOfBoundsException
+	// and SizeMismatchException.
+	Matrix get(std::size_t index) const;
+	void set(std::size_t index, const ConstMatrixView& matrix);
+
+	MatrixBatch transposed() const;
+	std::vector<double> trace() const;
+	std::vector<double> det() const;
+	// Write count() results to out.
+	void trace(double* out) const;
+	void det(double* out) const;
+
+private:
+	std::size_t offset(std::size_t index, std::size_t row, std::size_t col) const {
+		return ((index / LANES * rows_ + row)*cols_ + col)*LANES + index % LANES;
+	}
+
+	double* data_;
+	std::size_t count_;
+	std::size_t groups_;
+	std::size_t rows_;
+	std::size_t cols_;
+	std::size_t capacity_;
+};
+
+// out[i] = a[i] * b[i] for every matrix of the batches; out must already have
+// the shape of the products and must not be a or b.
+void multiply(const MatrixBatch& a, const MatrixBatch& b, MatrixBatch& out);
+MatrixBatch operator*(const MatrixBatch& a, const MatrixBatch& b);
+
+}  // namespace task
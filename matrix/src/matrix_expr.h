@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+namespace task {
+
+class Matrix;
+class LU;
+class Cholesky;
+
+// Base of everything that can be evaluated element by element into a Matrix.
+// Element-wise operators build a tree of these nodes instead of temporaries;
+// the tree is evaluated in one pass when it is assigned to a Matrix.
+// element(row, col) is an element of the result; taking the row and column
+// rather than a row-major index spares views a division per element.
+//
+// The read-only Matrix members are available on expressions as well, so that
+// code written when the operators returned a Matrix, such as (a + b).det()
+// or (a + b)[i][j], keeps working; they evaluate the expression first.
+template <class E>
+class MatrixExpr {
+public:
+	const E& self() const {
+		return static_cast<const E&>(*this);
+	}
+
+	std::size_t rows() const {
+		return self().rows();
+	}
+
+	std::size_t cols() const {
+		return self().cols();
+	}
+
+	double element(std::size_t row, std::size_t col) const {
+		return self().element(row, col);
+	}
+
+	Matrix eval() const;
+	// Row row of the result, by value.
+	std::vector<double> operator[](std::size_t row) const;
+	double det() const;
+	LU lu() const;
+	Cholesky cholesky() const;
+	Matrix inverse() const;
+	Matrix transposed() const;
+	double trace() const;
+	std::vector<double> getRow(std::size_t row) const;
+	std::vector<double> getColumn(std::size_t column) const;
+};
+
+namespace detail {
+
+// Matrices are captured by reference, intermediate nodes by value, so that a
+// tree built inside one full expression never refers to a dead node.
+template <class E>
+struct ExprOperand {
+	using type = const E;
+};
+
+template <>
+struct ExprOperand<Matrix> {
+	using type = const Matrix&;
+};
+
+[[noreturn]] void throw_size_mismatch();
+[[noreturn]] void throw_out_of_bounds();
+
+// Calls fn(idx, row, col) for the row-major indices [begin, end) of a result
+// with cols columns, dividing once per row instead of once per element.
+template <class Fn>
+void for_each_element(std::size_t begin, std::size_t end, std::size_t cols, const Fn& fn) {
+	if (begin >= end)
+		return;
+	std::size_t row = begin / cols, col = begin % cols;
+	for (std::size_t idx = begin; idx < end; row++, col = 0) {
+		std::size_t stop = end - idx < cols - col ? end : idx + cols - col;
+		for (; idx < stop; idx++, col++) {
+			fn(idx, row, col);
+		}
+	}
+}
+
+}  // namespace detail
+
+template <class L, class R>
+class MatrixSum : public MatrixExpr<MatrixSum<L, R>> {
+public:
+	MatrixSum(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+		if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+			detail::throw_size_mismatch();
+	}
+
+	std::size_t rows() const {
+		return lhs_.rows();
+	}
+
+	std::size_t cols() const {
+		return lhs_.cols();
+	}
+
+	double element(std::size_t row, std::size_t col) const {
+		return lhs_.element(row, col) + rhs_.element(row, col);
+	}
+
+	const L& lhs() const {
+		return lhs_;
+	}
+
+	const R& rhs() const {
+		return rhs_;
+	}
+
+private:
+	typename detail::ExprOperand<L>::type lhs_;
+	typename detail::ExprOperand<R>::type rhs_;
+};
+
+template <class L, class R>
+class MatrixDifference : public MatrixExpr<MatrixDifference<L, R>> {
+public:
+	MatrixDifference(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+		if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+			detail::throw_size_mismatch();
+	}
+
+	std::size_t rows() const {
+		return lhs_.rows();
+	}
+
+	std::size_t cols() const {
+		return lhs_.cols();
+	}
+
+	double element(std::size_t row, std::size_t col) const {
+		return lhs_.element(row, col) - rhs_.element(row, col);
+	}
+
+	const L& lhs() const {
+		return lhs_;
+	}
+
+	const R& rhs() const {
+		return rhs_;
+	}
+
+private:
+	typename detail::ExprOperand<L>::type lhs_;
+	typename detail::ExprOperand<R>::type rhs_;
+};
+
+template <class E>
+class MatrixNegation : public MatrixExpr<MatrixNegation<E>> {
+public:
+	explicit MatrixNegation(const E& operand) : operand_(operand) {}
+
+	std::size_t rows() const {
+		return operand_.rows();
+	}
+
+	std::size_t cols() const {
+		return operand_.cols();
+	}
+
+	double element(std::size_t row, std::size_t col) const {
+		return -operand_.element(row, col);
+	}
+
+	const E& operand() const {
+		return operand_;
+	}
+
+private:
+	typename detail::ExprOperand<E>::type operand_;
+};
+
+template <class E>
+class MatrixScaled : public MatrixExpr<MatrixScaled<E>> {
+public:
+	MatrixScaled(const E& operand, double factor) : operand_(operand), factor_(factor) {}
+
+	std::size_t rows() const {
+		return operand_.rows();
+	}
+
+	std::size_t cols() const {
+		return operand_.cols();
+	}
+
+	double element(std::size_t row, std::size_t col) const {
+		return operand_.element(row, col) * factor_;
+	}
+
+	const E& operand() const {
+		return operand_;
+	}
+
+	double factor() const {
+		return factor_;
+	}
+
+private:
+	typename detail::ExprOperand<E>::type operand_;
+	double factor_;
+};
+
+
+template <class L, class R>
+MatrixSum<L, R> operator+(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+	return MatrixSum<L, R>(lhs.self(), rhs.self());
+}
+
+template <class L, class R>
+MatrixDifference<L, R> operator-(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+	return MatrixDifference<L, R>(lhs.self(), rhs.self());
+}
+
+template <class E>
+MatrixNegation<E> operator-(const MatrixExpr<E>& operand) {
+	return MatrixNegation<E>(operand.self());
+}
+
+template <class E>
+MatrixScaled<E> operator*(const MatrixExpr<E>& operand, const double& factor) {
+	return MatrixScaled<E>(operand.self(), factor);
+}
+
+template <class E>
+MatrixScaled<E> operator*(const double& factor, const MatrixExpr<E>& operand) {
+	return MatrixScaled<E>(operand.self(), factor);
+}
+
+}  // namespace task
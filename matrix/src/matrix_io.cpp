@@ -0,0 +1,253 @@
+#include "matrix_io.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace task;
+
+namespace {
+
+MatrixFileHeader make_header(std::size_t rows, std::size_t cols) {
+	MatrixFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = MatrixFileHeader::MAGIC;
+	header.version = MatrixFileHeader::VERSION;
+	header.byte_order = MatrixFileHeader::BYTE_ORDER_MARK;
+	header.dtype = MatrixFileHeader::DTYPE_FLOAT64;
+	header.rows = rows;
+	header.cols = cols;
+	header.data_offset = sizeof(MatrixFileHeader);
+	header.alignment = MatrixFileHeader::ALIGNMENT;
+	return header;
+}
+
+std::uint32_t swap_bytes(std::uint32_t value) {
+	return __builtin_bswap32(value);
+}
+
+std::uint64_t swap_bytes(std::uint64_t value) {
+	return __builtin_bswap64(value);
+}
+
+// Checks the header and converts it to the native byte order. Returns true
+// if the elements are stored in the other byte order. The shape is rejected
+// if its size in bytes, or the end of the elements in the file, does not fit
+// in a size_t, so that callers can compute both without overflow.
+bool parse_header(MatrixFileHeader& header) {
+	bool swapped = false;
+	if (header.byte_order != MatrixFileHeader::BYTE_ORDER_MARK) {
+		if (swap_bytes(header.byte_order) != MatrixFileHeader::BYTE_ORDER_MARK)
+			throw IOException();
+		swapped = true;
+		header.magic = swap_bytes(header.magic);
+		header.version = swap_bytes(header.version);
+		header.dtype = swap_bytes(header.dtype);
+		header.rows = swap_bytes(header.rows);
+		header.cols = swap_bytes(header.cols);
+		header.data_offset = swap_bytes(header.data_offset);
+		header.alignment = swap_bytes(header.alignment);
+	}
+	if (header.magic != MatrixFileHeader::MAGIC || header.version != MatrixFileHeader::VERSION ||
+		header.dtype != MatrixFileHeader::DTYPE_FLOAT64 ||
+		header.data_offset < sizeof(MatrixFileHeader) || header.data_offset % sizeof(double) != 0 ||
+		header.alignment == 0 || (header.alignment & (header.alignment - 1)) != 0 ||
+		header.data_offset % header.alignment != 0)
+		throw IOException();
+	std::size_t count, bytes, end;
+	if (__builtin_mul_overflow(header.rows, header.cols, &count) ||
+		__builtin_mul_overflow(count, sizeof(double), &bytes) ||
+		__builtin_add_overflow(header.data_offset, bytes, &end))
+		throw IOException();
+	return swapped;
+}
+
+// Elements read at a time from streams that cannot tell their length.
+const std::size_t READ_CHUNK = 1 << 17;
+
+// Bytes between the read position of input and its end, or -1 if input
+// cannot seek, like a pipe.
+std::streamoff remaining_bytes(std::istream& input) {
+	std::streampos position = input.tellg();
+	if (position == std::streampos(-1))
+		return -1;
+	input.seekg(0, std::ios::end);
+	std::streampos end = input.tellg();
+	input.clear();
+	input.seekg(position);
+	if (end == std::streampos(-1) || !input)
+		return -1;
+	return end - position;
+}
+
+// Reads count elements a chunk at a time, so that a header claiming more
+// data than the stream has costs no more memory than the data itself.
+std::vector<double> read_in_chunks(std::istream& input, std::size_t count) {
+	std::vector<double> elements;
+	while (elements.size() < count) {
+		std::size_t chunk = std::min(READ_CHUNK, count - elements.size());
+		elements.resize(elements.size() + chunk);
+		if (!input.read(reinterpret_cast<char*>(elements.data() + elements.size() - chunk),
+						chunk * sizeof(double)))
+			throw IOException();
+	}
+	return elements;
+}
+
+void write_rows(std::ostream& output, const ConstMatrixView& matrix) {
+	if (matrix.contiguous()) {
+		output.write(reinterpret_cast<const char*>(matrix.data()),
+					 matrix.rows() * matrix.cols() * sizeof(double));
+	} else {
+		for (std::size_t i = 0; i < matrix.rows(); i++) {
+			output.write(reinterpret_cast<const char*>(matrix.data() + i*matrix.ld()),
+						 matrix.cols() * sizeof(double));
+		}
+	}
+	if (!output)
+		throw IOException();
+}
+
+}  // namespace
+
+void task::write_binary(std::ostream& output, const ConstMatrixView& matrix) {
+	MatrixFileHeader header = make_header(matrix.rows(), matrix.cols());
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	write_rows(output, matrix);
+}
+
+void task::write_binary(const std::string& path, const ConstMatrixView& matrix) {
+	std::ofstream output(path, std::ios::binary);
+	if (!output)
+		throw IOException();
+	write_binary(output, matrix);
+}
+
+Matrix task::read_binary(std::istream& input) {
+	MatrixFileHeader header;
+	if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		throw IOException();
+	bool swapped = parse_header(header);
+	std::size_t count = header.rows * header.cols;
+	std::size_t skip = header.data_offset - sizeof(header);
+	// The matrix is allocated only once the stream is known to hold it.
+	std::streamoff remaining = remaining_bytes(input);
+	if (remaining >= 0 && static_cast<std::size_t>(remaining) < skip + count * sizeof(double))
+		throw IOException();
+	input.ignore(skip);
+
+	std::vector<double> elements;
+	if (remaining < 0 && count > READ_CHUNK)
+		elements = read_in_chunks(input, count);
+	Matrix result(header.rows, header.cols, UNINITIALIZED);
+	double* data = count > 0 ? result.row_data(0) : nullptr;
+	if (!elements.empty())
+		std::copy(elements.begin(), elements.end(), data);
+	else if (!input.read(reinterpret_cast<char*>(data), count * sizeof(double)))
+		throw IOException();
+	if (swapped) {
+		auto* words = reinterpret_cast<std::uint64_t*>(data);
+		for (std::size_t i = 0; i < count; i++) {
+			words[i] = swap_bytes(words[i]);
+		}
+	}
+	return result;
+}
+
+Matrix task::read_binary(const std::string& path) {
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+		throw IOException();
+	return read_binary(input);
+}
+
+task::MatrixWriter::MatrixWriter(const std::string& path, std::size_t rows, std::size_t cols)
+		: output_(path, std::ios::binary), rows_(rows), cols_(cols), written_(0) {
+	if (!output_)
+		throw IOException();
+	MatrixFileHeader header = make_header(rows, cols);
+	output_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+task::MatrixWriter::~MatrixWriter() {
+	if (output_.is_open())
+		output_.close();
+}
+
+void task::MatrixWriter::write_row(const double* row) {
+	write_rows(ConstMatrixView(row, 1, cols_, cols_));
+}
+
+void task::MatrixWriter::write_rows(const ConstMatrixView& rows) {
+	if (rows.cols() != cols_ || written_ + rows.rows() > rows_)
+		throw SizeMismatchException();
+	::write_rows(output_, rows);
+	written_ += rows.rows();
+}
+
+void task::MatrixWriter::close() {
+	output_.close();
+	if (written_ != rows_ || output_.fail())
+		throw IOException();
+}
+
+task::MappedMatrix::MappedMatrix(void* mapping, std::size_t length, const double* data,
+								 std::size_t rows, std::size_t cols)
+		: mapping_(mapping), length_(length), data_(data), rows_(rows), cols_(cols) {}
+
+task::MappedMatrix::MappedMatrix(MappedMatrix&& other) noexcept
+		: mapping_(other.mapping_), length_(other.length_), data_(other.data_),
+		  rows_(other.rows_), cols_(other.cols_) {
+	other.mapping_ = nullptr;
+	other.length_ = 0;
+}
+
+MappedMatrix& task::MappedMatrix::operator=(MappedMatrix&& other) noexcept {
+	std::swap(mapping_, other.mapping_);
+	std::swap(length_, other.length_);
+	std::swap(data_, other.data_);
+	std::swap(rows_, other.rows_);
+	std::swap(cols_, other.cols_);
+	return *this;
+}
+
+task::MappedMatrix::~MappedMatrix() {
+	if (mapping_ != nullptr)
+		munmap(mapping_, length_);
+}
+
+MappedMatrix task::Matrix::mmap_open(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw IOException();
+	struct stat info;
+	if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(MatrixFileHeader)) {
+		::close(fd);
+		throw IOException();
+	}
+	std::size_t length = info.st_size;
+	void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		throw IOException();
+
+	MatrixFileHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+	bool valid = false;
+	try {
+		// A foreign byte order would need a converted copy, which mapping avoids.
+		valid = !parse_header(header) &&
+				header.data_offset + header.rows * header.cols * sizeof(double) <= length;
+	} catch (const IOException&) {
+	}
+	if (!valid) {
+		munmap(mapping, length);
+		throw IOException();
+	}
+	const double* data = reinterpret_cast<const double*>(
+			static_cast<const char*>(mapping) + header.data_offset);
+	return MappedMatrix(mapping, length, data, header.rows, header.cols);
+}
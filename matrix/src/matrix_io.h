@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "matrix.h"
+
+
+namespace task {
+
+class IOException : public std::exception {};
+
+// Binary matrix file: a 64-byte header followed by the row-major elements.
+// The elements start at data_offset, a multiple of alignment, so a mapped
+// file can be used in place. byte_order holds BYTE_ORDER_MARK as written by
+// the producing machine and tells readers whether to swap bytes.
+struct MatrixFileHeader {
+	static const std::uint32_t MAGIC = 0x5441534b;  // "TASK"
+	static const std::uint32_t VERSION = 1;
+	static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+	static const std::uint32_t DTYPE_FLOAT64 = 1;
+	static const std::uint32_t ALIGNMENT = 64;
+
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint32_t dtype;
+	std::uint64_t rows;
+	std::uint64_t cols;
+	std::uint64_t data_offset;
+	std::uint32_t alignment;
+	std::uint32_t reserved[5];
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "the header is exactly 64 bytes");
+
+void write_binary(std::ostream& output, const ConstMatrixView& matrix);
+void write_binary(const std::string& path, const ConstMatrixView& matrix);
+Matrix read_binary(std::istream& input);
+Matrix read_binary(const std::string& path);
+
+// Writes a matrix of known shape to a binary file a few rows at a time, so it
+// never has to be in memory as a whole.
+class MatrixWriter {
+public:
+	MatrixWriter(const std::string& path, std::size_t rows, std::size_t cols);
+	~MatrixWriter();
+
+	void write_row(const double* row);
+	void write_rows(const ConstMatrixView& rows);
+	// Throws IOException unless exactly rows() rows were written.
+	void close();
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+private:
+	std::ofstream output_;
+	std::size_t rows_;
+	std::size_t cols_;
+	std::size_t written_;
+};
+
+// Read-only memory mapping of a binary matrix file, see Matrix::mmap_open.
+// Nothing is parsed or copied: the view points into the mapping, which lives
+// as long as this object.
+class MappedMatrix {
+public:
+	MappedMatrix(MappedMatrix&& other) noexcept;
+	MappedMatrix& operator=(MappedMatrix&& other) noexcept;
+	MappedMatrix(const MappedMatrix&) = delete;
+	MappedMatrix& operator=(const MappedMatrix&) = delete;
+	~MappedMatrix();
+
+	ConstMatrixView view() const {
+		return ConstMatrixView(data_, rows_, cols_, cols_);
+	}
+
+	operator ConstMatrixView() const {
+		return view();
+	}
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+private:
+	friend class Matrix;
+	MappedMatrix(void* mapping, std::size_t length, const double* data,
+				 std::size_t rows, std::size_t cols);
+
+	void* mapping_;
+	std::size_t length_;
+	const double* data_;
+	std::size_t rows_;
+	std::size_t cols_;
+};
+
+}  // namespace task
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "matrix_expr.h"
+
+
+namespace task {
+
+template <class T>
+class BasicMatrixView;
+
+// Non-owning view of size elements placed stride elements apart: a row
+// (stride 1) or a column (stride = row length) of a matrix. Like matrix
+// views, assignments write through to the elements; the operators below
+// and the matrix-vector product in matrix.h return std::vector<double>.
+template <class T>
+class BasicStridedVector {
+public:
+	BasicStridedVector(T* data, std::size_t size, std::size_t stride)
+			: data_(data), size_(size), stride_(stride) {}
+
+	// Copies refer to the same elements.
+	BasicStridedVector(const BasicStridedVector&) = default;
+
+	template <class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+	BasicStridedVector(const BasicStridedVector<U>& other)
+			: data_(other.data()), size_(other.size()), stride_(other.stride()) {}
+
+	// The element-wise assignments take a vector of the same size, which may
+	// be this one but not another overlapping one.
+	template <class U>
+	const BasicStridedVector& operator=(const BasicStridedVector<U>& other) const {
+		check_size(other);
+		for (std::size_t i = 0; i < size_; i++) {
+			data_[i*stride_] = other[i];
+		}
+		return *this;
+	}
+
+	const BasicStridedVector& operator=(const BasicStridedVector& other) const {
+		return operator=<T>(other);
+	}
+
+	template <class U>
+	const BasicStridedVector& operator+=(const BasicStridedVector<U>& other) const {
+		check_size(other);
+		for (std::size_t i = 0; i < size_; i++) {
+			data_[i*stride_] += other[i];
+		}
+		return *this;
+	}
+
+	template <class U>
+	const BasicStridedVector& operator-=(const BasicStridedVector<U>& other) const {
+		check_size(other);
+		for (std::size_t i = 0; i < size_; i++) {
+			data_[i*stride_] -= other[i];
+		}
+		return *this;
+	}
+
+	const BasicStridedVector& operator*=(double factor) const {
+		for (std::size_t i = 0; i < size_; i++) {
+			data_[i*stride_] *= factor;
+		}
+		return *this;
+	}
+
+	// The elements as a size x 1 matrix view, for the Matrix operators.
+	BasicMatrixView<T> as_column() const;
+
+	T& operator[](std::size_t idx) const {
+		return data_[idx*stride_];
+	}
+
+	std::size_t size() const {
+		return size_;
+	}
+
+	std::size_t stride() const {
+		return stride_;
+	}
+
+	T* data() const {
+		return data_;
+	}
+
+private:
+	template <class U>
+	void check_size(const BasicStridedVector<U>& other) const {
+		if (other.size() != size_)
+			detail::throw_size_mismatch();
+	}
+
+	T* data_;
+	std::size_t size_;
+	std::size_t stride_;
+};
+
+using StridedVector = BasicStridedVector<double>;
+using ConstStridedVector = BasicStridedVector<const double>;
+
+template <class T, class U>
+std::vector<double> operator+(const BasicStridedVector<T>& lhs, const BasicStridedVector<U>& rhs) {
+	if (lhs.size() != rhs.size())
+		detail::throw_size_mismatch();
+	std::vector<double> result(lhs.size());
+	for (std::size_t i = 0; i < lhs.size(); i++) {
+		result[i] = lhs[i] + rhs[i];
+	}
+	return result;
+}
+
+template <class T, class U>
+std::vector<double> operator-(const BasicStridedVector<T>& lhs, const BasicStridedVector<U>& rhs) {
+	if (lhs.size() != rhs.size())
+		detail::throw_size_mismatch();
+	std::vector<double> result(lhs.size());
+	for (std::size_t i = 0; i < lhs.size(); i++) {
+		result[i] = lhs[i] - rhs[i];
+	}
+	return result;
+}
+
+template <class T>
+std::vector<double> operator-(const BasicStridedVector<T>& operand) {
+	std::vector<double> result(operand.size());
+	for (std::size_t i = 0; i < operand.size(); i++) {
+		result[i] = -operand[i];
+	}
+	return result;
+}
+
+template <class T>
+std::vector<double> operator*(const BasicStridedVector<T>& operand, const double& factor) {
+	std::vector<double> result(operand.size());
+	for (std::size_t i = 0; i < operand.size(); i++) {
+		result[i] = operand[i] * factor;
+	}
+	return result;
+}
+
+template <class T>
+std::vector<double> operator*(const double& factor, const BasicStridedVector<T>& operand) {
+	return operand * factor;
+}
+
+// Sum of lhs[i] * rhs[i], in order.
+template <class T, class U>
+double dot(const BasicStridedVector<T>& lhs, const BasicStridedVector<U>& rhs) {
+	if (lhs.size() != rhs.size())
+		detail::throw_size_mismatch();
+	double result = 0;
+	for (std::size_t i = 0; i < lhs.size(); i++) {
+		result += lhs[i] * rhs[i];
+	}
+	return result;
+}
+
+
+// Non-owning view of a rows x cols block of a row-major buffer whose rows are
+// ld elements apart. Views take part in the lazy arithmetic of matrix_expr.h
+// and in products. A view must not outlive the matrix it refers to.
+template <class T>
+class BasicMatrixView : public MatrixExpr<BasicMatrixView<T>> {
+public:
+	BasicMatrixView(T* data, std::size_t rows, std::size_t cols, std::size_t ld)
+			: data_(data), rows_(rows), cols_(cols), ld_(ld) {}
+
+	// Copies refer to the same elements. Declared because operator= below
+	// writes through the view instead of rebinding it.
+	BasicMatrixView(const BasicMatrixView&) = default;
+
+	template <class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+	BasicMatrixView(const BasicMatrixView<U>& other)
+			: data_(other.data()), rows_(other.rows()), cols_(other.cols()), ld_(other.ld()) {}
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+	std::size_t ld() const {
+		return ld_;
+	}
+
+	T* data() const {
+		return data_;
+	}
+
+	bool contiguous() const {
+		return ld_ == cols_ || rows_ <= 1;
+	}
+
+	double element(std::size_t row, std::size_t col) const {
+		return data_[row*ld_ + col];
+	}
+
+	T& operator()(std::size_t row, std::size_t col) const {
+		return data_[row*ld_ + col];
+	}
+
+	BasicStridedVector<T> row(std::size_t row) const {
+		return BasicStridedVector<T>(data_ + row*ld_, cols_, 1);
+	}
+
+	BasicStridedVector<T> column(std::size_t col) const {
+		return BasicStridedVector<T>(data_ + col, rows_, ld_);
+	}
+
+	BasicMatrixView block(std::size_t row, std::size_t col,
+						  std::size_t rows, std::size_t cols) const {
+		if (row + rows > rows_ || col + cols > cols_)
+			detail::throw_out_of_bounds();
+		return BasicMatrixView(data_ + row*ld_ + col, rows, cols, ld_);
+	}
+
+	// Writes an expression into the viewed elements. The expression may read
+	// the same elements but not other overlapping ones.
+	template <class E>
+	const BasicMatrixView& operator=(const MatrixExpr<E>& expr) const {
+		check_shape(expr);
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				data_[i*ld_ + j] = expr.element(i, j);
+			}
+		}
+		return *this;
+	}
+
+	const BasicMatrixView& operator=(const BasicMatrixView& other) const {
+		return *this = static_cast<const MatrixExpr<BasicMatrixView>&>(other);
+	}
+
+	template <class E>
+	const BasicMatrixView& operator+=(const MatrixExpr<E>& expr) const {
+		check_shape(expr);
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				data_[i*ld_ + j] += expr.element(i, j);
+			}
+		}
+		return *this;
+	}
+
+	template <class E>
+	const BasicMatrixView& operator-=(const MatrixExpr<E>& expr) const {
+		check_shape(expr);
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				data_[i*ld_ + j] -= expr.element(i, j);
+			}
+		}
+		return *this;
+	}
+
+	const BasicMatrixView& operator*=(double factor) const {
+		for (std::size_t i = 0; i < rows_; i++) {
+			for (std::size_t j = 0; j < cols_; j++) {
+				data_[i*ld_ + j] *= factor;
+			}
+		}
+		return *this;
+	}
+
+private:
+	template <class E>
+	void check_shape(const MatrixExpr<E>& expr) const {
+		if (expr.rows() != rows_ || expr.cols() != cols_)
+			detail::throw_size_mismatch();
+	}
+
+	T* data_;
+	std::size_t rows_;
+	std::size_t cols_;
+	std::size_t ld_;
+};
+
+using MatrixView = BasicMatrixView<double>;
+using ConstMatrixView = BasicMatrixView<const double>;
+
+template <class T>
+BasicMatrixView<T> BasicStridedVector<T>::as_column() const {
+	return BasicMatrixView<T>(data_, size_, 1, stride_);
+}
+
+}  // namespace task
@@ -0,0 +1,297 @@
+#include "simd.h"
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TASK_SIMD_X86
+#endif
+
+using namespace task;
+
+namespace {
+
+struct Kernels {
+	SimdLevel level;
+	void (*add)(const double*, const double*, double*, std::size_t);
+	void (*subtract)(const double*, const double*, double*, std::size_t);
+	void (*negate)(const double*, double*, std::size_t);
+	void (*scale)(const double*, double, double*, std::size_t);
+	double (*trace)(const double*, std::size_t);
+	bool (*all_close)(const double*, const double*, std::size_t, double);
+};
+
+void add_scalar(const double* a, const double* b, double* out, std::size_t n) {
+	for (std::size_t i = 0; i < n; i++) {
+		out[i] = a[i] + b[i];
+	}
+}
+
+void subtract_scalar(const double* a, const double* b, double* out, std::size_t n) {
+	for (std::size_t i = 0; i < n; i++) {
+		out[i] = a[i] - b[i];
+	}
+}
+
+void negate_scalar(const double* a, double* out, std::size_t n) {
+	for (std::size_t i = 0; i < n; i++) {
+		out[i] = -a[i];
+	}
+}
+
+void scale_scalar(const double* a, double factor, double* out, std::size_t n) {
+	for (std::size_t i = 0; i < n; i++) {
+		out[i] = a[i] * factor;
+	}
+}
+
+double trace_scalar(const double* a, std::size_t n) {
+	double result = 0;
+	for (std::size_t i = 0; i < n; i++) {
+		result += a[i*(n + 1)];
+	}
+	return result;
+}
+
+bool all_close_scalar(const double* a, const double* b, std::size_t n, double eps) {
+	for (std::size_t i = 0; i < n; i++) {
+		if (fabs(a[i] - b[i]) > eps)
+			return false;
+	}
+	return true;
+}
+
+const Kernels SCALAR_KERNELS = {
+	SimdLevel::Scalar, add_scalar, subtract_scalar, negate_scalar, scale_scalar, trace_scalar, all_close_scalar,
+};
+
+#ifdef TASK_SIMD_X86
+
+__attribute__((target("sse2")))
+void add_sse2(const double* a, const double* b, double* out, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		_mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+	}
+	add_scalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("sse2")))
+void subtract_sse2(const double* a, const double* b, double* out, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		_mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+	}
+	subtract_scalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("sse2")))
+void negate_sse2(const double* a, double* out, std::size_t n) {
+	const __m128d sign = _mm_set1_pd(-0.0);
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		_mm_storeu_pd(out + i, _mm_xor_pd(_mm_loadu_pd(a + i), sign));
+	}
+	negate_scalar(a + i, out + i, n - i);
+}
+
+__attribute__((target("sse2")))
+void scale_sse2(const double* a, double factor, double* out, std::size_t n) {
+	const __m128d f = _mm_set1_pd(factor);
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		_mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), f));
+	}
+	scale_scalar(a + i, factor, out + i, n - i);
+}
+
+// The diagonal is strided, so vectorizing only splits the dependency chain.
+__attribute__((target("sse2")))
+double trace_sse2(const double* a, std::size_t n) {
+	std::size_t stride = n + 1;
+	__m128d acc = _mm_setzero_pd();
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		acc = _mm_add_pd(acc, _mm_set_pd(a[(i + 1)*stride], a[i*stride]));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, acc);
+	double result = lanes[0] + lanes[1];
+	for (; i < n; i++) {
+		result += a[i*stride];
+	}
+	return result;
+}
+
+__attribute__((target("sse2")))
+bool all_close_sse2(const double* a, const double* b, std::size_t n, double eps) {
+	const __m128d sign = _mm_set1_pd(-0.0);
+	const __m128d e = _mm_set1_pd(eps);
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d diff = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		if (_mm_movemask_pd(_mm_cmpgt_pd(diff, e)) != 0)
+			return false;
+	}
+	return all_close_scalar(a + i, b + i, n - i, eps);
+}
+
+const Kernels SSE2_KERNELS = {
+	SimdLevel::SSE2, add_sse2, subtract_sse2, negate_sse2, scale_sse2, trace_sse2, all_close_sse2,
+};
+
+__attribute__((target("avx2")))
+void add_avx2(const double* a, const double* b, double* out, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+	}
+	add_scalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void subtract_avx2(const double* a, const double* b, double* out, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+	}
+	subtract_scalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void negate_avx2(const double* a, double* out, std::size_t n) {
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+	}
+	negate_scalar(a + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void scale_avx2(const double* a, double factor, double* out, std::size_t n) {
+	const __m256d f = _mm256_set1_pd(factor);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), f));
+	}
+	scale_scalar(a + i, factor, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+double trace_avx2(const double* a, std::size_t n) {
+	long long stride = static_cast<long long>(n + 1);
+	const __m256i offsets = _mm256_set_epi64x(3*stride, 2*stride, stride, 0);
+	__m256d acc = _mm256_setzero_pd();
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		acc = _mm256_add_pd(acc, _mm256_i64gather_pd(a + i*(n + 1), offsets, 8));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, acc);
+	double result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < n; i++) {
+		result += a[i*(n + 1)];
+	}
+	return result;
+}
+
+__attribute__((target("avx2")))
+bool all_close_avx2(const double* a, const double* b, std::size_t n, double eps) {
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	const __m256d e = _mm256_set1_pd(eps);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d diff = _mm256_andnot_pd(sign,
+				_mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+		if (_mm256_movemask_pd(_mm256_cmp_pd(diff, e, _CMP_GT_OQ)) != 0)
+			return false;
+	}
+	return all_close_scalar(a + i, b + i, n - i, eps);
+}
+
+const Kernels AVX2_KERNELS = {
+	SimdLevel::AVX2, add_avx2, subtract_avx2, negate_avx2, scale_avx2, trace_avx2, all_close_avx2,
+};
+
+#endif
+
+SimdLevel detect_simd_level() {
+#ifdef TASK_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SimdLevel::SSE2;
+#endif
+	return SimdLevel::Scalar;
+}
+
+const Kernels* kernels_for(SimdLevel level) {
+#ifdef TASK_SIMD_X86
+	if (level == SimdLevel::AVX2)
+		return &AVX2_KERNELS;
+	if (level == SimdLevel::SSE2)
+		return &SSE2_KERNELS;
+#endif
+	return &SCALAR_KERNELS;
+}
+
+// Detected on first use rather than by global initializers, so that the
+// kernels also work from static initializers in other translation units.
+SimdLevel max_level() {
+	static const SimdLevel level = detect_simd_level();
+	return level;
+}
+
+// The kernel table in use, which also records its level. A single atomic
+// pointer, so set_simd_level may run while other threads call the kernels
+// and they always see a level together with its own table.
+std::atomic<const Kernels*>& current() {
+	static std::atomic<const Kernels*> kernels(kernels_for(max_level()));
+	return kernels;
+}
+
+const Kernels& kernels() {
+	return *current().load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+SimdLevel task::simd_level() {
+	return kernels().level;
+}
+
+SimdLevel task::max_simd_level() {
+	return max_level();
+}
+
+void task::set_simd_level(SimdLevel level) {
+	if (level > max_level())
+		level = max_level();
+	current().store(kernels_for(level), std::memory_order_relaxed);
+}
+
+void task::detail::add(const double* a, const double* b, double* out, std::size_t n) {
+	kernels().add(a, b, out, n);
+}
+
+void task::detail::subtract(const double* a, const double* b, double* out, std::size_t n) {
+	kernels().subtract(a, b, out, n);
+}
+
+void task::detail::negate(const double* a, double* out, std::size_t n) {
+	kernels().negate(a, out, n);
+}
+
+void task::detail::scale(const double* a, double factor, double* out, std::size_t n) {
+	kernels().scale(a, factor, out, n);
+}
+
+double task::detail::trace(const double* a, std::size_t n) {
+	return kernels().trace(a, n);
+}
+
+bool task::detail::all_close(const double* a, const double* b, std::size_t n, double eps) {
+	return kernels().all_close(a, b, n, eps);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+// Instruction set used by the element-wise kernels. The best level supported
+// by the CPU is picked on first use; set_simd_level can lower it, which is how
+// the benchmarks and tests reach every code path.
+enum class SimdLevel {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+SimdLevel simd_level();
+SimdLevel max_simd_level();
+void set_simd_level(SimdLevel level);
+
+namespace detail {
+
+// Kernels over contiguous buffers; out may alias the inputs.
+void add(const double* a, const double* b, double* out, std::size_t n);
+void subtract(const double* a, const double* b, double* out, std::size_t n);
+void negate(const double* a, double* out, std::size_t n);
+void scale(const double* a, double factor, double* out, std::size_t n);
+
+// Sum of the diagonal of a row-major n x n matrix.
+double trace(const double* a, std::size_t n);
+
+// True if no pair of elements differs by more than eps.
+bool all_close(const double* a, const double* b, std::size_t n, double eps);
+
+}  // namespace detail
+}  // namespace task
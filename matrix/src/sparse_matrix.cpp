@@ -0,0 +1,290 @@
+#include "sparse_matrix.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace task;
+
+namespace {
+
+// Rows per thread chosen so that a chunk covers about ELEMENTWISE_GRAIN
+// stored entries.
+std::size_t min_rows(std::size_t nnz, std::size_t rows, std::size_t row_cost) {
+	std::size_t per_row = std::max<std::size_t>(nnz / std::max<std::size_t>(rows, 1), 1) * row_cost;
+	return detail::ELEMENTWISE_GRAIN / per_row + 1;
+}
+
+}  // namespace
+
+task::CooMatrix::CooMatrix(std::size_t rows, std::size_t cols) : rows_(rows), cols_(cols) {}
+
+void task::CooMatrix::add(std::size_t row, std::size_t col, double value) {
+	if (row >= rows_ || col >= cols_)
+		throw OutOfBoundsException();
+	row_indices_.push_back(row);
+	col_indices_.push_back(col);
+	values_.push_back(value);
+}
+
+void task::CooMatrix::reserve(std::size_t nnz) {
+	row_indices_.reserve(nnz);
+	col_indices_.reserve(nnz);
+	values_.reserve(nnz);
+}
+
+// Counting sort by row, then a sort by column within each row, merging
+// duplicate positions on the way.
+CsrMatrix task::CooMatrix::to_csr() const {
+	std::vector<std::size_t> offsets(rows_ + 1, 0);
+	for (std::size_t row : row_indices_) {
+		offsets[row + 1]++;
+	}
+	for (std::size_t i = 0; i < rows_; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+	std::vector<std::pair<std::size_t, double>> entries(nnz());
+	std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+	for (std::size_t i = 0; i < nnz(); i++) {
+		entries[next[row_indices_[i]]++] = {col_indices_[i], values_[i]};
+	}
+
+	std::vector<std::size_t> row_offsets(rows_ + 1, 0);
+	std::vector<std::size_t> col_indices;
+	std::vector<double> values;
+	col_indices.reserve(nnz());
+	values.reserve(nnz());
+	for (std::size_t i = 0; i < rows_; i++) {
+		auto begin = entries.begin() + offsets[i], end = entries.begin() + offsets[i + 1];
+		std::sort(begin, end, [](const std::pair<std::size_t, double>& x,
+								 const std::pair<std::size_t, double>& y) {
+			return x.first < y.first;
+		});
+		std::size_t row_start = values.size();
+		for (auto it = begin; it != end; ++it) {
+			if (values.size() > row_start && col_indices.back() == it->first) {
+				values.back() += it->second;
+			} else {
+				col_indices.push_back(it->first);
+				values.push_back(it->second);
+			}
+		}
+		row_offsets[i + 1] = values.size();
+	}
+	return CsrMatrix(rows_, cols_, std::move(row_offsets), std::move(col_indices), std::move(values));
+}
+
+Matrix task::CooMatrix::to_matrix() const {
+	return to_csr().to_matrix();
+}
+
+task::CsrMatrix::CsrMatrix(std::size_t rows, std::size_t cols) : rows_(rows),
+																 cols_(cols),
+																 row_offsets_(rows + 1, 0) {}
+
+task::CsrMatrix::CsrMatrix(const ConstMatrixView& matrix, double drop_tolerance)
+		: rows_(matrix.rows()), cols_(matrix.cols()), row_offsets_(matrix.rows() + 1, 0) {
+	for (std::size_t i = 0; i < rows_; i++) {
+		const double* row = matrix.data() + i*matrix.ld();
+		for (std::size_t j = 0; j < cols_; j++) {
+			if (std::abs(row[j]) > drop_tolerance) {
+				col_indices_.push_back(j);
+				values_.push_back(row[j]);
+			}
+		}
+		row_offsets_[i + 1] = values_.size();
+	}
+}
+
+task::CsrMatrix::CsrMatrix(std::size_t rows, std::size_t cols, std::vector<std::size_t> row_offsets,
+						   std::vector<std::size_t> col_indices, std::vector<double> values)
+		: rows_(rows), cols_(cols), row_offsets_(std::move(row_offsets)),
+		  col_indices_(std::move(col_indices)), values_(std::move(values)) {
+	if (row_offsets_.size() != rows_ + 1 || row_offsets_[0] != 0 ||
+		row_offsets_[rows_] != values_.size() || col_indices_.size() != values_.size())
+		throw SizeMismatchException();
+	for (std::size_t i = 0; i < rows_; i++) {
+		if (row_offsets_[i] > row_offsets_[i + 1])
+			throw SizeMismatchException();
+		for (std::size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; p++) {
+			if (col_indices_[p] >= cols_ || (p > row_offsets_[i] && col_indices_[p] <= col_indices_[p - 1]))
+				throw SizeMismatchException();
+		}
+	}
+}
+
+Matrix task::CsrMatrix::to_matrix() const {
+	Matrix result(rows_, cols_, UNINITIALIZED);
+	double* data = result.view().data();
+	std::fill(data, data + rows_*cols_, 0.);
+	for (std::size_t i = 0; i < rows_; i++) {
+		for (std::size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; p++) {
+			data[i*cols_ + col_indices_[p]] = values_[p];
+		}
+	}
+	return result;
+}
+
+CooMatrix task::CsrMatrix::to_coo() const {
+	CooMatrix result(rows_, cols_);
+	result.reserve(nnz());
+	for (std::size_t i = 0; i < rows_; i++) {
+		for (std::size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; p++) {
+			result.add(i, col_indices_[p], values_[p]);
+		}
+	}
+	return result;
+}
+
+double task::CsrMatrix::get(std::size_t row, std::size_t col) const {
+	if (row >= rows_ || col >= cols_)
+		throw OutOfBoundsException();
+	auto begin = col_indices_.begin() + row_offsets_[row];
+	auto end = col_indices_.begin() + row_offsets_[row + 1];
+	auto it = std::lower_bound(begin, end, col);
+	if (it == end || *it != col)
+		return 0;
+	return values_[it - col_indices_.begin()];
+}
+
+// Counting sort by column. Rows are visited in order, so the columns of the
+// transpose come out sorted.
+CsrMatrix task::CsrMatrix::transposed() const {
+	std::vector<std::size_t> row_offsets(cols_ + 1, 0);
+	for (std::size_t col : col_indices_) {
+		row_offsets[col + 1]++;
+	}
+	for (std::size_t j = 0; j < cols_; j++) {
+		row_offsets[j + 1] += row_offsets[j];
+	}
+	std::vector<std::size_t> col_indices(nnz());
+	std::vector<double> values(nnz());
+	std::vector<std::size_t> next(row_offsets.begin(), row_offsets.end() - 1);
+	for (std::size_t i = 0; i < rows_; i++) {
+		for (std::size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; p++) {
+			std::size_t q = next[col_indices_[p]]++;
+			col_indices[q] = i;
+			values[q] = values_[p];
+		}
+	}
+	return CsrMatrix(cols_, rows_, std::move(row_offsets), std::move(col_indices), std::move(values));
+}
+
+void task::CsrMatrix::multiply(const double* x, double* y) const {
+	detail::parallel_for(rows_, min_rows(nnz(), rows_, 1), [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			double sum = 0;
+			for (std::size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; p++) {
+				sum += values_[p] * x[col_indices_[p]];
+			}
+			y[i] = sum;
+		}
+	});
+}
+
+std::vector<double> task::CsrMatrix::operator*(const std::vector<double>& x) const {
+	if (x.size() != cols_)
+		throw SizeMismatchException();
+	std::vector<double> y(rows_);
+	multiply(x.data(), y.data());
+	return y;
+}
+
+// Row i of the result is the sum of the rows of b picked by the entries of
+// row i of a.
+void task::multiply(const CsrMatrix& a, const ConstMatrixView& b, const MatrixView& out) {
+	if (a.cols() != b.rows() || out.rows() != a.rows() || out.cols() != b.cols())
+		throw SizeMismatchException();
+	const std::vector<std::size_t>& offsets = a.row_offsets();
+	const std::vector<std::size_t>& cols = a.col_indices();
+	const std::vector<double>& values = a.values();
+	std::size_t n = b.cols();
+	detail::parallel_for(a.rows(), min_rows(a.nnz(), a.rows(), n), [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			double* out_row = out.data() + i*out.ld();
+			std::fill(out_row, out_row + n, 0.);
+			for (std::size_t p = offsets[i]; p < offsets[i + 1]; p++) {
+				double factor = values[p];
+				const double* b_row = b.data() + cols[p]*b.ld();
+				for (std::size_t j = 0; j < n; j++) {
+					out_row[j] += factor * b_row[j];
+				}
+			}
+		}
+	});
+}
+
+// Row i of the result is the sum of the sparse rows of b weighted by row i
+// of a; zeros of a are skipped.
+void task::multiply(const ConstMatrixView& a, const CsrMatrix& b, const MatrixView& out) {
+	if (a.cols() != b.rows() || out.rows() != a.rows() || out.cols() != b.cols())
+		throw SizeMismatchException();
+	const std::vector<std::size_t>& offsets = b.row_offsets();
+	const std::vector<std::size_t>& cols = b.col_indices();
+	const std::vector<double>& values = b.values();
+	std::size_t row_cost = std::max<std::size_t>(b.nnz(), 1);
+	detail::parallel_for(a.rows(), detail::ELEMENTWISE_GRAIN / row_cost + 1, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			const double* a_row = a.data() + i*a.ld();
+			double* out_row = out.data() + i*out.ld();
+			std::fill(out_row, out_row + out.cols(), 0.);
+			for (std::size_t k = 0; k < a.cols(); k++) {
+				double factor = a_row[k];
+				if (factor == 0)
+					continue;
+				for (std::size_t p = offsets[k]; p < offsets[k + 1]; p++) {
+					out_row[cols[p]] += factor * values[p];
+				}
+			}
+		}
+	});
+}
+
+Matrix task::operator*(const CsrMatrix& a, const Matrix& b) {
+	Matrix result(a.rows(), b.cols(), UNINITIALIZED);
+	multiply(a, b, result);
+	return result;
+}
+
+Matrix task::operator*(const Matrix& a, const CsrMatrix& b) {
+	Matrix result(a.rows(), b.cols(), UNINITIALIZED);
+	multiply(a, b, result);
+	return result;
+}
+
+// Gustavson's algorithm: each row of the result is accumulated in a dense
+// row of b.cols() elements, remembering which columns were touched.
+CsrMatrix task::operator*(const CsrMatrix& a, const CsrMatrix& b) {
+	if (a.cols() != b.rows())
+		throw SizeMismatchException();
+	const std::size_t UNTOUCHED = static_cast<std::size_t>(-1);
+	std::vector<double> accumulator(b.cols(), 0);
+	std::vector<std::size_t> marker(b.cols(), UNTOUCHED);
+	std::vector<std::size_t> touched;
+	std::vector<std::size_t> row_offsets(a.rows() + 1, 0);
+	std::vector<std::size_t> col_indices;
+	std::vector<double> values;
+	for (std::size_t i = 0; i < a.rows(); i++) {
+		touched.clear();
+		for (std::size_t p = a.row_offsets()[i]; p < a.row_offsets()[i + 1]; p++) {
+			std::size_t k = a.col_indices()[p];
+			double factor = a.values()[p];
+			for (std::size_t q = b.row_offsets()[k]; q < b.row_offsets()[k + 1]; q++) {
+				std::size_t j = b.col_indices()[q];
+				if (marker[j] != i) {
+					marker[j] = i;
+					accumulator[j] = 0;
+					touched.push_back(j);
+				}
+				accumulator[j] += factor * b.values()[q];
+			}
+		}
+		std::sort(touched.begin(), touched.end());
+		for (std::size_t j : touched) {
+			col_indices.push_back(j);
+			values.push_back(accumulator[j]);
+		}
+		row_offsets[i + 1] = values.size();
+	}
+	return CsrMatrix(a.rows(), b.cols(), std::move(row_offsets), std::move(col_indices), std::move(values));
+}
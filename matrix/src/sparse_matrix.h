@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "matrix.h"
+
+
+namespace task {
+
+class CsrMatrix;
+
+// Sparse matrix in coordinate form: an unordered list of (row, col, value)
+// entries, convenient for building a matrix one element at a time. Duplicate
+// entries add up when converted to CSR.
+class CooMatrix {
+public:
+	CooMatrix(std::size_t rows, std::size_t cols);
+
+	// Throws OutOfBoundsException for a position outside the matrix.
+	void add(std::size_t row, std::size_t col, double value);
+	void reserve(std::size_t nnz);
+
+	CsrMatrix to_csr() const;
+	Matrix to_matrix() const;
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+	std::size_t nnz() const {
+		return values_.size();
+	}
+
+	const std::vector<std::size_t>& row_indices() const {
+		return row_indices_;
+	}
+
+	const std::vector<std::size_t>& col_indices() const {
+		return col_indices_;
+	}
+
+	const std::vector<double>& values() const {
+		return values_;
+	}
+
+private:
+	std::size_t rows_;
+	std::size_t cols_;
+	std::vector<std::size_t> row_indices_;
+	std::vector<std::size_t> col_indices_;
+	std::vector<double> values_;
+};
+
+// Sparse matrix in compressed sparse row form. The entries of row i are
+// values()[row_offsets()[i] .. row_offsets()[i + 1]), with their columns in
+// col_indices() in increasing order. Unlike task::Matrix, a new CsrMatrix is
+// all zeros.
+class CsrMatrix {
+public:
+	CsrMatrix(std::size_t rows, std::size_t cols);
+	// Keeps the elements whose absolute value is greater than drop_tolerance.
+	explicit CsrMatrix(const ConstMatrixView& matrix, double drop_tolerance = 0);
+	// Takes ownership of ready-made arrays; throws SizeMismatchException if
+	// they do not describe a valid rows x cols matrix.
+	CsrMatrix(std::size_t rows, std::size_t cols, std::vector<std::size_t> row_offsets,
+			  std::vector<std::size_t> col_indices, std::vector<double> values);
+
+	Matrix to_matrix() const;
+	CooMatrix to_coo() const;
+
+	// Element access by binary search within the row; throws
+	// OutOfBoundsException for a position outside the matrix.
+	double get(std::size_t row, std::size_t col) const;
+
+	CsrMatrix transposed() const;
+
+	// y = A x for x of cols() and y of rows() elements.
+	void multiply(const double* x, double* y) const;
+	std::vector<double> operator*(const std::vector<double>& x) const;
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	std::size_t cols() const {
+		return cols_;
+	}
+
+	std::size_t nnz() const {
+		return values_.size();
+	}
+
+	double density() const {
+		return rows_*cols_ == 0 ? 0 : double(nnz()) / (double(rows_) * double(cols_));
+	}
+
+	const std::vector<std::size_t>& row_offsets() const {
+		return row_offsets_;
+	}
+
+	const std::vector<std::size_t>& col_indices() const {
+		return col_indices_;
+	}
+
+	const std::vector<double>& values() const {
+		return values_;
+	}
+
+private:
+	std::size_t rows_;
+	std::size_t cols_;
+	std::vector<std::size_t> row_offsets_;
+	std::vector<std::size_t> col_indices_;
+	std::vector<double> values_;
+};
+
+// Sparse-dense products, written into out (which must have the result's
+// shape) or returned as a new matrix.
+void multiply(const CsrMatrix& a, const ConstMatrixView& b, const MatrixView& out);
+void multiply(const ConstMatrixView& a, const CsrMatrix& b, const MatrixView& out);
+Matrix operator*(const CsrMatrix& a, const Matrix& b);
+Matrix operator*(const Matrix& a, const CsrMatrix& b);
+
+// Sparse-sparse product; the result keeps only structurally nonzero entries.
+CsrMatrix operator*(const CsrMatrix& a, const CsrMatrix& b);
+
+}  // namespace task
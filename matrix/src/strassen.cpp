@@ -0,0 +1,179 @@
+#include "strassen.h"
+#include "buffer_pool.h"
+#include "gemm.h"
+#include "simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+using namespace task;
+
+namespace {
+
+// Atomic because products read them from any thread, pool workers included.
+std::atomic<ProductAlgorithm> algorithm(ProductAlgorithm::Classical);
+std::atomic<std::size_t> cutoff_size(DEFAULT_STRASSEN_CUTOFF);
+
+bool recurses(std::size_t m, std::size_t n, std::size_t k, std::size_t cutoff) {
+	return std::min({m, n, k}) >= std::max<std::size_t>(cutoff, 2);
+}
+
+// out = a + b and out = a - b over m x n blocks; out may alias a or b.
+void add(std::size_t m, std::size_t n, const double* a, std::size_t lda,
+		 const double* b, std::size_t ldb, double* out, std::size_t ldo) {
+	for (std::size_t i = 0; i < m; i++) {
+		detail::add(a + i*lda, b + i*ldb, out + i*ldo, n);
+	}
+}
+
+void subtract(std::size_t m, std::size_t n, const double* a, std::size_t lda,
+			  const double* b, std::size_t ldb, double* out, std::size_t ldo) {
+	for (std::size_t i = 0; i < m; i++) {
+		detail::subtract(a + i*lda, b + i*ldb, out + i*ldo, n);
+	}
+}
+
+// Every level needs an m/2 x k/2, a k/2 x n/2 and an m/2 x n/2 temporary;
+// the products of one level run one after another and share what follows.
+std::size_t workspace_size(std::size_t m, std::size_t n, std::size_t k, std::size_t cutoff) {
+	std::size_t total = 0;
+	while (recurses(m, n, k, cutoff)) {
+		m /= 2;
+		n /= 2;
+		k /= 2;
+		total += m*k + k*n + m*n;
+	}
+	return total;
+}
+
+// Odd dimensions are peeled: the recursion covers the even part and the last
+// row, column or inner index is added separately.
+void fix_up(std::size_t m, std::size_t n, std::size_t k,
+			const double* a, std::size_t lda,
+			const double* b, std::size_t ldb,
+			double* c, std::size_t ldc) {
+	std::size_t m2 = m / 2 * 2, n2 = n / 2 * 2, k2 = k / 2 * 2;
+	if (k2 < k) {
+		const double* b_row = b + k2*ldb;
+		for (std::size_t i = 0; i < m2; i++) {
+			double factor = a[i*lda + k2];
+			for (std::size_t j = 0; j < n2; j++) {
+				c[i*ldc + j] += factor * b_row[j];
+			}
+		}
+	}
+	if (n2 < n) {
+		for (std::size_t i = 0; i < m; i++) {
+			double sum = 0;
+			for (std::size_t p = 0; p < k; p++) {
+				sum += a[i*lda + p] * b[p*ldb + n2];
+			}
+			c[i*ldc + n2] = sum;
+		}
+	}
+	if (m2 < m) {
+		double* c_row = c + m2*ldc;
+		std::memset(c_row, 0, n2 * sizeof(double));
+		for (std::size_t p = 0; p < k; p++) {
+			double factor = a[m2*lda + p];
+			for (std::size_t j = 0; j < n2; j++) {
+				c_row[j] += factor * b[p*ldb + j];
+			}
+		}
+	}
+}
+
+// Winograd's schedule with the quadrants of C as scratch space:
+//   S1 = A21 + A22, S2 = S1 - A11, S3 = A11 - A21, S4 = A12 - S2,
+//   T1 = B12 - B11, T2 = B22 - T1, T3 = B22 - B12, T4 = T2 - B21,
+//   P1 = A11 B11, P2 = A12 B21, P3 = S4 B22, P4 = A22 T4,
+//   P5 = S1 T1, P6 = S2 T2, P7 = S3 T3,
+//   C11 = P1 + P2, C12 = P1 + P6 + P5 + P3,
+//   C21 = P1 + P6 + P7 - P4, C22 = P1 + P6 + P7 + P5.
+void recurse(std::size_t m, std::size_t n, std::size_t k,
+			 const double* a, std::size_t lda,
+			 const double* b, std::size_t ldb,
+			 double* c, std::size_t ldc, std::size_t cutoff, double* work) {
+	if (!recurses(m, n, k, cutoff)) {
+		detail::parallel_gemm(m, n, k, a, lda, b, ldb, c, ldc);
+		return;
+	}
+	std::size_t hm = m / 2, hn = n / 2, hk = k / 2;
+	const double* a11 = a;
+	const double* a12 = a + hk;
+	const double* a21 = a + hm*lda;
+	const double* a22 = a21 + hk;
+	const double* b11 = b;
+	const double* b12 = b + hn;
+	const double* b21 = b + hk*ldb;
+	const double* b22 = b21 + hn;
+	double* c11 = c;
+	double* c12 = c + hn;
+	double* c21 = c + hm*ldc;
+	double* c22 = c21 + hn;
+	double* x = work;
+	double* y = x + hm*hk;
+	double* z = y + hk*hn;
+	double* rest = z + hm*hn;
+
+	subtract(hm, hk, a11, lda, a21, lda, x, hk);
+	subtract(hk, hn, b22, ldb, b12, ldb, y, hn);
+	recurse(hm, hn, hk, x, hk, y, hn, c21, ldc, cutoff, rest);  // C21 = P7
+
+	add(hm, hk, a21, lda, a22, lda, x, hk);
+	subtract(hk, hn, b12, ldb, b11, ldb, y, hn);
+	recurse(hm, hn, hk, x, hk, y, hn, c22, ldc, cutoff, rest);  // C22 = P5
+
+	subtract(hm, hk, x, hk, a11, lda, x, hk);
+	subtract(hk, hn, b22, ldb, y, hn, y, hn);
+	recurse(hm, hn, hk, x, hk, y, hn, c12, ldc, cutoff, rest);  // C12 = P6
+
+	subtract(hm, hk, a12, lda, x, hk, x, hk);
+	recurse(hm, hn, hk, x, hk, b22, ldb, c11, ldc, cutoff, rest);  // C11 = P3
+
+	recurse(hm, hn, hk, a11, lda, b11, ldb, z, hn, cutoff, rest);  // Z = P1
+
+	add(hm, hn, z, hn, c12, ldc, c12, ldc);
+	add(hm, hn, c12, ldc, c21, ldc, c21, ldc);
+	add(hm, hn, c12, ldc, c22, ldc, c12, ldc);
+	add(hm, hn, c21, ldc, c22, ldc, c22, ldc);
+	add(hm, hn, c12, ldc, c11, ldc, c12, ldc);
+
+	subtract(hk, hn, y, hn, b21, ldb, y, hn);
+	recurse(hm, hn, hk, a22, lda, y, hn, c11, ldc, cutoff, rest);  // C11 = P4
+	subtract(hm, hn, c21, ldc, c11, ldc, c21, ldc);
+
+	recurse(hm, hn, hk, a12, lda, b21, ldb, c11, ldc, cutoff, rest);  // C11 = P2
+	add(hm, hn, z, hn, c11, ldc, c11, ldc);
+
+	fix_up(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+}  // namespace
+
+void task::set_product_algorithm(ProductAlgorithm value, std::size_t cutoff) {
+	cutoff_size.store(cutoff, std::memory_order_relaxed);
+	algorithm.store(value, std::memory_order_relaxed);
+}
+
+ProductAlgorithm task::product_algorithm() {
+	return algorithm.load(std::memory_order_relaxed);
+}
+
+std::size_t task::strassen_cutoff() {
+	return cutoff_size.load(std::memory_order_relaxed);
+}
+
+void task::detail::strassen(std::size_t m, std::size_t n, std::size_t k,
+							const double* a, std::size_t lda,
+							const double* b, std::size_t ldb,
+							double* c, std::size_t ldc, std::size_t cutoff) {
+	if (!recurses(m, n, k, cutoff)) {
+		parallel_gemm(m, n, k, a, lda, b, ldb, c, ldc);
+		return;
+	}
+	std::size_t capacity;
+	double* work = allocate_buffer(workspace_size(m, n, k, cutoff), capacity);
+	recurse(m, n, k, a, lda, b, ldb, c, ldc, cutoff, work);
+	release_buffer(work, capacity);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+// Algorithm behind the Matrix product. Strassen uses Winograd's variant of
+// Strassen's recursion (7 half-size products and 15 additions instead of 8
+// products) while all three dimensions are at least the cutoff, and the
+// classical kernel below it. It saves flops on large products at the price
+// of a somewhat larger rounding error, so it is off by default. The setting
+// may be changed while other threads multiply; each product reads it once.
+enum class ProductAlgorithm {
+	Classical,
+	Strassen
+};
+
+const std::size_t DEFAULT_STRASSEN_CUTOFF = 512;
+
+void set_product_algorithm(ProductAlgorithm algorithm, std::size_t cutoff = DEFAULT_STRASSEN_CUTOFF);
+ProductAlgorithm product_algorithm();
+std::size_t strassen_cutoff();
+
+namespace detail {
+
+// Same contract as gemm. The temporaries of all recursion levels come from a
+// single workspace allocated up front.
+void strassen(std::size_t m, std::size_t n, std::size_t k,
+			  const double* a, std::size_t lda,
+			  const double* b, std::size_t ldb,
+			  double* c, std::size_t ldc, std::size_t cutoff);
+
+}  // namespace detail
+}  // namespace task
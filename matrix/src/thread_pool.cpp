@@ -0,0 +1,150 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+using namespace task;
+
+namespace {
+
+// Callers take a reference under pool_mutex and keep the pool alive through
+// it, so set_num_threads may replace it while they run.
+std::shared_ptr<ThreadPool> pool;
+std::mutex pool_mutex;
+
+// pool->size(), or 1 without a pool. Kept apart from the pool so that
+// parallel_chunks, on the path of every element-wise operation, reads it
+// without taking pool_mutex.
+std::atomic<std::size_t> thread_count(1);
+
+std::shared_ptr<ThreadPool> current_pool() {
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return pool;
+}
+
+// Set inside pool tasks so that nested parallel_for calls run serially
+// instead of waiting on the pool they are running in.
+thread_local bool in_pool_task = false;
+
+}  // namespace
+
+task::ThreadPool::ThreadPool(std::size_t threads) : fn_(nullptr), count_(0), next_(0),
+													pending_(0), generation_(0), stop_(false) {
+	for (std::size_t i = 1; i < threads; i++) {
+		workers_.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+task::ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+void task::ThreadPool::run(std::size_t count, const std::function<void(std::size_t)>& fn) {
+	// The job state is shared by all callers, one job at a time.
+	std::lock_guard<std::mutex> run_lock(run_mutex_);
+	std::unique_lock<std::mutex> lock(mutex_);
+	fn_ = &fn;
+	count_ = count;
+	next_ = 0;
+	pending_ = count;
+	generation_++;
+	wake_.notify_all();
+	drain(lock);
+	done_.wait(lock, [this] { return pending_ == 0; });
+	fn_ = nullptr;
+	if (error_) {
+		std::exception_ptr error = error_;
+		error_ = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void task::ThreadPool::work() {
+	std::size_t seen = 0;
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+		if (stop_)
+			return;
+		seen = generation_;
+		drain(lock);
+	}
+}
+
+void task::ThreadPool::drain(std::unique_lock<std::mutex>& lock) {
+	while (fn_ != nullptr && next_ < count_) {
+		std::size_t idx = next_++;
+		const std::function<void(std::size_t)>& fn = *fn_;
+		lock.unlock();
+		bool nested = in_pool_task;
+		in_pool_task = true;
+		std::exception_ptr error;
+		try {
+			fn(idx);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		in_pool_task = nested;
+		lock.lock();
+		if (error) {
+			// Skip the indices nobody has taken yet.
+			if (!error_)
+				error_ = error;
+			pending_ -= count_ - next_;
+			next_ = count_;
+		}
+		if (--pending_ == 0)
+			done_.notify_all();
+	}
+}
+
+void task::set_num_threads(std::size_t threads) {
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	threads = std::max<std::size_t>(threads, 1);
+	if (pool && pool->size() == threads)
+		return;
+	pool.reset();
+	thread_count.store(1, std::memory_order_relaxed);
+	if (threads > 1) {
+		pool = std::make_shared<ThreadPool>(threads);
+		thread_count.store(threads, std::memory_order_relaxed);
+	}
+}
+
+std::size_t task::num_threads() {
+	return thread_count.load(std::memory_order_relaxed);
+}
+
+std::size_t task::detail::parallel_chunks(std::size_t count, std::size_t min_chunk) {
+	if (in_pool_task)
+		return 1;
+	std::size_t threads = num_threads();
+	if (threads == 1)
+		return 1;
+	min_chunk = std::max<std::size_t>(min_chunk, 1);
+	return std::max<std::size_t>(std::min(threads, count / min_chunk), 1);
+}
+
+void task::detail::run_chunks(std::size_t count, std::size_t chunks,
+							  const std::function<void(std::size_t, std::size_t)>& fn) {
+	auto chunk = [&](std::size_t chunk) {
+		fn(count * chunk / chunks, count * (chunk + 1) / chunks);
+	};
+	// The pool may have been removed since parallel_chunks looked at it; the
+	// chunks are the same either way.
+	std::shared_ptr<ThreadPool> current = current_pool();
+	if (!current) {
+		for (std::size_t i = 0; i < chunks; i++) {
+			chunk(i);
+		}
+		return;
+	}
+	current->run(chunks, chunk);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace task {
+
+// Fixed set of worker threads. run(count, fn) calls fn(0) ... fn(count - 1)
+// spread over the workers and the calling thread and returns when all calls
+// are done. Which thread runs an index does not matter to the callers: every
+// index always covers the same piece of work. Calls from several threads run
+// one after another. If fn throws, the remaining indices are skipped and run
+// rethrows the first exception.
+class ThreadPool {
+public:
+	explicit ThreadPool(std::size_t threads);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	std::size_t size() const {
+		return workers_.size() + 1;
+	}
+
+	void run(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+private:
+	void work();
+	void drain(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> workers_;
+	std::mutex run_mutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	const std::function<void(std::size_t)>* fn_;
+	std::size_t count_;
+	std::size_t next_;
+	std::size_t pending_;
+	std::size_t generation_;
+	std::exception_ptr error_;
+	bool stop_;
+};
+
+// Number of threads used by Matrix operations, 1 (no parallelism) by default.
+// Results are bit-for-bit reproducible for a given thread count.
+void set_num_threads(std::size_t threads);
+std::size_t num_threads();
+
+namespace detail {
+
+// Smallest number of elements worth handing to a thread for element-wise work.
+const std::size_t ELEMENTWISE_GRAIN = 1 << 15;
+
+// Number of chunks parallel_for uses for count items.
+std::size_t parallel_chunks(std::size_t count, std::size_t min_chunk);
+
+// Calls fn(begin, end) for each of chunks equal parts of [0, count) on the pool.
+void run_chunks(std::size_t count, std::size_t chunks,
+				const std::function<void(std::size_t, std::size_t)>& fn);
+
+// Splits [0, count) into at most num_threads() contiguous chunks of at least
+// min_chunk items and calls fn(begin, end) for each of them, in parallel.
+// The split depends only on count, min_chunk and num_threads(). The serial
+// case calls fn directly and does not allocate.
+template <class Fn>
+void parallel_for(std::size_t count, std::size_t min_chunk, const Fn& fn) {
+	std::size_t chunks = parallel_chunks(count, min_chunk);
+	if (chunks == 1) {
+		fn(0, count);
+		return;
+	}
+	run_chunks(count, chunks, fn);
+}
+
+}  // namespace detail
+}  // namespace task
@@ -0,0 +1,94 @@
+#include "transpose.h"
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Blocks of up to this many elements per side are handled by plain loops.
+const std::size_t LEAF = 16;
+
+// Swaps the r x c block at u with the transpose of the c x r block at l.
+void swap_transposed(double* u, double* l, std::size_t r, std::size_t c, std::size_t ld) {
+	if (r <= LEAF && c <= LEAF) {
+		for (std::size_t i = 0; i < r; i++) {
+			for (std::size_t j = 0; j < c; j++) {
+				std::swap(u[i*ld + j], l[j*ld + i]);
+			}
+		}
+	} else if (r >= c) {
+		std::size_t half = r / 2;
+		swap_transposed(u, l, half, c, ld);
+		swap_transposed(u + half*ld, l + half, r - half, c, ld);
+	} else {
+		std::size_t half = c / 2;
+		swap_transposed(u, l, r, half, ld);
+		swap_transposed(u + half, l + half*ld, r, c - half, ld);
+	}
+}
+
+// Transposes the n x n block at a in place (stride ld).
+void transpose_diagonal(double* a, std::size_t n, std::size_t ld) {
+	if (n <= LEAF) {
+		for (std::size_t i = 0; i < n; i++) {
+			for (std::size_t j = i + 1; j < n; j++) {
+				std::swap(a[i*ld + j], a[j*ld + i]);
+			}
+		}
+		return;
+	}
+	std::size_t half = n / 2;
+	transpose_diagonal(a, half, ld);
+	transpose_diagonal(a + half*ld + half, n - half, ld);
+	swap_transposed(a + half, a + half*ld, half, n - half, ld);
+}
+
+}  // namespace
+
+void task::detail::transpose(const double* src, std::size_t rows, std::size_t cols,
+							 std::size_t lds, double* dst, std::size_t ldd) {
+	if (rows <= LEAF && cols <= LEAF) {
+		for (std::size_t i = 0; i < rows; i++) {
+			for (std::size_t j = 0; j < cols; j++) {
+				dst[j*ldd + i] = src[i*lds + j];
+			}
+		}
+	} else if (rows >= cols) {
+		std::size_t half = rows / 2;
+		transpose(src, half, cols, lds, dst, ldd);
+		transpose(src + half*lds, rows - half, cols, lds, dst + half, ldd);
+	} else {
+		std::size_t half = cols / 2;
+		transpose(src, rows, half, lds, dst, ldd);
+		transpose(src + half, rows, cols - half, lds, dst + half*ldd, ldd);
+	}
+}
+
+void task::detail::transpose_square(double* a, std::size_t n) {
+	transpose_diagonal(a, n, n);
+}
+
+// Follows the permutation cycles of the transpose: the element at index i
+// moves to i * rows mod (n - 1). A bit per element marks finished positions,
+// which is 1/64 of the matrix instead of a second copy.
+void task::detail::transpose_in_place(double* a, std::size_t rows, std::size_t cols) {
+	if (rows == cols) {
+		transpose_square(a, rows);
+		return;
+	}
+	std::size_t n = rows * cols;
+	if (rows <= 1 || cols <= 1)
+		return;
+	std::vector<bool> moved(n);
+	for (std::size_t start = 1; start + 1 < n; start++) {
+		if (moved[start])
+			continue;
+		double carried = a[start];
+		std::size_t idx = start;
+		do {
+			std::size_t next = idx * rows % (n - 1);
+			std::swap(carried, a[next]);
+			moved[next] = true;
+			idx = next;
+		} while (idx != start);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+namespace detail {
+
+// dst = src^T for a row-major rows x cols block of src. lds and ldd are the
+// row strides of src and dst. Recursively halves the larger side, so it is
+// cache friendly without knowing the cache size.
+void transpose(const double* src, std::size_t rows, std::size_t cols, std::size_t lds,
+			   double* dst, std::size_t ldd);
+
+// Transposes a row-major n x n matrix in place.
+void transpose_square(double* a, std::size_t n);
+
+// Transposes a row-major rows x cols matrix in place; the result is a
+// row-major cols x rows matrix in the same buffer.
+void transpose_in_place(double* a, std::size_t rows, std::size_t cols);
+
+}  // namespace detail
+}  // namespace task
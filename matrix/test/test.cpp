@@ -3,13 +3,101 @@
 #include <random>
 #include <algorithm>
 #include <sstream>
+#include <fstream>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
 #include "src/matrix.h"
+#include "src/simd.h"
+#include "src/gemm.h"
+#include "src/thread_pool.h"
+#include "src/fixed_matrix.h"
+#include "src/basic_matrix.h"
+#include "src/sparse_matrix.h"
+#include "src/strassen.h"
+#include "src/accumulation.h"
+#include "src/matrix_batch.h"
 
 
 using task::Matrix;
 
 
+// A stream buffer that cannot seek, like a pipe.
+class PipeBuf : public std::stringbuf {
+public:
+    explicit PipeBuf(const std::string& bytes) : std::stringbuf(bytes) {}
+
+protected:
+    pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override {
+        return pos_type(-1);
+    }
+
+    pos_type seekpos(pos_type, std::ios_base::openmode) override {
+        return pos_type(-1);
+    }
+};
+
+
+std::atomic<size_t> allocation_count(0);
+
+// Counting replacements of the allocation functions. They are kept out of
+// line: GCC otherwise inlines malloc and free into the new[] and delete[]
+// expressions of BasicMatrix and warns that they do not match.
+__attribute__((noinline)) void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment) {
+    ++allocation_count;
+    size_t align = static_cast<size_t>(alignment);
+    if (void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+
 size_t RandomUInt(size_t max = -1) {
     static std::mt19937 rand(std::random_device{}());
 
@@ -67,9 +155,18 @@ void FailWithMsg(const std::string& msg, int line) {
 
 const double EPS = 1e-6;
 
+// Element-wise kernels used from a static initializer, which may run before
+// those of the library's translation units.
+const double STATIC_INIT_TRACE = [] {
+    Matrix mat(4, 4);
+    return (mat + mat * 2.).trace();
+}();
+
 
 int main(int argc, char** argv) {
 
+    ASSERT_TRUE_MSG(STATIC_INIT_TRACE == 12., "Kernels during static initialization")
+
     {
         Matrix mat;
         ASSERT_TRUE_MSG(mat[0][0] == 1., "Default constructor")
@@ -118,6 +215,16 @@ int main(int argc, char** argv) {
 
         ASSERT_TRUE_MSG(mat[0][0] == 1. && mat[0][1] == 0. && mat[1][0] == 0. && mat[1][1] == 0., "resize()")
 
+        mat1.at_unchecked(0, 1) = 5.;
+        ASSERT_TRUE_MSG(mat1.get(0, 1) == 5. && mat_c.at_unchecked(1, 1) == 400., "at_unchecked()")
+        ASSERT_TRUE_MSG(mat1.row_data(1) == &mat1.get(1, 0) && mat1.row_data(1)[1] == 400., "row_data()")
+#if TASK_MATRIX_BOUNDS_CHECK
+        ASSERT_EXCEPTION_MSG(mat1.at_unchecked(0, 2), task::OutOfBoundsException, "Debug bounds check")
+        ASSERT_EXCEPTION_MSG(mat1.row_data(2), task::OutOfBoundsException, "Debug bounds check")
+        ASSERT_EXCEPTION_MSG(mat1[2], task::OutOfBoundsException, "Debug bounds check")
+        ASSERT_EXCEPTION_MSG(mat1[0][2], std::out_of_range, "Debug bounds check")
+#endif
+
         /*
         REPEAT(1000) {
             // oh boy i sure can't wait to resize
@@ -191,6 +298,839 @@ int main(int argc, char** argv) {
     }
 
 
+    {
+        auto mat1 = RandomMatrix(30, 40);
+        auto mat2 = RandomMatrix(30, 40);
+        auto copy = mat1;
+
+        size_t before = allocation_count;
+        mat1 += mat2;
+        mat1 -= mat2;
+        mat1 *= 2.;
+        copy = mat1;
+        Matrix moved = std::move(mat1);
+        mat1 = std::move(mat2);
+        ASSERT_TRUE_MSG(allocation_count == before, "Compound assignment / move allocations")
+
+        ASSERT_TRUE_MSG(moved == copy, "Move constructor")
+        ASSERT_TRUE_MSG(mat1.rows() == 30 && mat1.cols() == 40, "Move assignment")
+
+        auto mat3 = RandomMatrix(30, 40);
+        Matrix expected = mat1;
+        expected *= 2.;
+        expected += moved;
+        expected -= mat3;
+
+        before = allocation_count;
+        copy = mat1 * 2. + moved - mat3;
+        ASSERT_TRUE_MSG(allocation_count == before, "Expression assignment allocations")
+        ASSERT_TRUE_MSG(copy == expected, "Expression assignment")
+
+        copy = mat1;
+        copy = -(copy - mat3) * 0.5 + copy;
+        ASSERT_TRUE_MSG(copy == 0.5 * (mat1 + mat3), "Aliased expression assignment")
+
+        // Call forms from when the operators returned a Matrix.
+        auto square = RandomMatrix(12, 12), square2 = RandomMatrix(12, 12);
+        Matrix sum = square + square2, difference = square - square2;
+        ASSERT_TRUE_MSG(fabs((square + square2).det() - sum.det()) < EPS, "Expression det()")
+        ASSERT_TRUE_MSG((square + square2)[3][4] == sum[3][4], "Expression operator[]")
+        ASSERT_TRUE_MSG((square - square2).transposed() == difference.transposed(), "Expression transposed()")
+        ASSERT_TRUE_MSG((square * 2.).trace() == 2. * square.trace(), "Expression trace()")
+        ASSERT_TRUE_MSG((-square).inverse() == -square.inverse(), "Expression inverse()")
+        ASSERT_TRUE_MSG((square + square2).getRow(5) == sum.getRow(5) &&
+                        (square + square2).getColumn(7) == sum.getColumn(7), "Expression getRow() / getColumn()")
+        std::stringstream printed, expected_printed;
+        printed << square + square2;
+        expected_printed << sum;
+        ASSERT_TRUE_MSG(printed.str() == expected_printed.str(), "Expression operator <<")
+
+        // Temporary Matrix operands are evaluated right away, so auto holds a
+        // Matrix and not a reference to a dead temporary.
+        auto scaled = RandomMatrix(5, 6) * 2.;
+        auto shifted = square - Matrix(square2);
+        static_assert(std::is_same<decltype(scaled), Matrix>::value, "temporary * scalar is a Matrix");
+        static_assert(std::is_same<decltype(-Matrix(square)), Matrix>::value, "-temporary is a Matrix");
+        ASSERT_TRUE_MSG(scaled.rows() == 5 && shifted == difference, "Temporary operands")
+        ASSERT_TRUE_MSG(Matrix(square) + square2 == sum && square + Matrix(square2) == sum &&
+                        Matrix(square) - Matrix(square2) == difference && 2. * Matrix(sum) == sum * 2.,
+                        "Temporary operands")
+    }
+
+    REPEAT(10)
+    {
+        size_t rows = RandomUInt(1, 40), cols = RandomUInt(1, 40);
+        auto mat = RandomMatrix(rows, cols);
+        auto original = mat;
+        for (int step = 0; step < 4; ++step) {
+            size_t new_rows = RandomUInt(0, 50), new_cols = RandomUInt(0, 50);
+            mat.resize(new_rows, new_cols);
+            ASSERT_TRUE_MSG(mat.rows() == new_rows && mat.cols() == new_cols, "resize() shape")
+            for (size_t i = 0; i < new_rows; ++i) {
+                for (size_t j = 0; j < new_cols; ++j) {
+                    double expected = (i < rows && j < cols) ? original.get(i, j) : 0.;
+                    ASSERT_TRUE_MSG(mat.get(i, j) == expected, "resize() elements")
+                }
+            }
+            rows = std::min(rows, new_rows);
+            cols = std::min(cols, new_cols);
+        }
+
+        // Shrinking, growing back within capacity and appending rows after
+        // reserve() keep the buffer.
+        size_t width = RandomUInt(2, 20);
+        Matrix stream(1, width);
+        stream.reserve(100 * width);
+        size_t before = allocation_count;
+        for (size_t i = 2; i <= 100; ++i) {
+            stream.resize(i, width);
+            stream.set(i - 1, 0, double(i));
+        }
+        stream.resize(10, width - 1);
+        stream.resize(100, width);
+        ASSERT_TRUE_MSG(allocation_count == before, "resize() within capacity allocations")
+        ASSERT_TRUE_MSG(stream.capacity() >= 100 * width, "reserve()")
+        ASSERT_TRUE_MSG(stream.get(9, 0) == 10. && stream.get(10, 0) == 0., "resize() within capacity")
+    }
+
+
+    {
+        for (size_t size : {1, 3, 17, 100}) {
+            Matrix mat(size, size + 1);
+            auto address = reinterpret_cast<uintptr_t>(&mat.get(0, 0));
+            ASSERT_TRUE_MSG(address % task::BUFFER_ALIGNMENT == 0, "Buffer alignment")
+        }
+
+        auto mat1 = RandomMatrix(50, 60);
+        auto mat2 = RandomMatrix(60, 50);
+        {
+            Matrix product = mat1 * mat2;
+            Matrix copy = mat1;
+        }
+        size_t before = allocation_count;
+        task::BufferPoolStats stats = task::buffer_pool_stats();
+        for (int i = 0; i < 10; i++) {
+            Matrix product = mat1 * mat2;
+            Matrix copy = mat1;
+        }
+        ASSERT_TRUE_MSG(allocation_count == before, "Pooled temporaries allocations")
+        ASSERT_TRUE_MSG(task::buffer_pool_stats().hits >= stats.hits + 20, "Pooled temporaries reuse")
+
+        Matrix raw(7, 9, task::UNINITIALIZED);
+        ASSERT_TRUE_MSG(raw.rows() == 7 && raw.cols() == 9, "Uninitialized constructor")
+        Matrix identity(7, 9);
+        for (size_t i = 0; i < 7; i++) {
+            for (size_t j = 0; j < 9; j++) {
+                ASSERT_TRUE_MSG(identity.get(i, j) == (i == j ? 1 : 0), "Identity constructor")
+            }
+        }
+
+        task::trim_buffer_pool();
+        ASSERT_TRUE_MSG(task::buffer_pool_stats().cached_bytes == 0, "Pool trimming")
+
+        // The pool keeps at most buffer_pool_limit() bytes, however many
+        // buffers are released at once.
+        size_t default_limit = task::buffer_pool_limit();
+        task::set_buffer_pool_limit(1 << 20);
+        {
+            std::vector<Matrix> many;
+            for (int i = 0; i < 6; ++i) {
+                for (size_t size : {100, 150, 220}) {
+                    many.emplace_back(size, size);
+                }
+            }
+        }
+        size_t cached = task::buffer_pool_stats().cached_bytes;
+        ASSERT_TRUE_MSG(cached > 0 && cached <= (1 << 20), "Pool limit")
+        task::set_buffer_pool_limit(cached / 2);
+        ASSERT_TRUE_MSG(task::buffer_pool_stats().cached_bytes <= cached / 2, "Lowering the pool limit")
+        task::set_buffer_pool_limit(default_limit);
+    }
+
+    for (auto level : {task::SimdLevel::Scalar, task::SimdLevel::SSE2, task::SimdLevel::AVX2}) {
+        task::set_simd_level(level);
+        size_t rows = RandomUInt(1, 40), cols = RandomUInt(1, 40);
+        auto mat1 = RandomMatrix(rows, cols);
+        auto mat2 = RandomMatrix(rows, cols);
+        double scalar = RandomDouble();
+
+        Matrix sum = mat1 + mat2, difference = mat1 - mat2, negated = -mat1, scaled = mat1 * scalar;
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                ASSERT_TRUE_MSG(sum[i][j] == mat1[i][j] + mat2[i][j], "SIMD operator +")
+                ASSERT_TRUE_MSG(difference[i][j] == mat1[i][j] - mat2[i][j], "SIMD operator -")
+                ASSERT_TRUE_MSG(negated[i][j] == -mat1[i][j], "SIMD unary -")
+                ASSERT_TRUE_MSG(scaled[i][j] == mat1[i][j] * scalar, "SIMD scalar *")
+            }
+        }
+
+        auto square = RandomMatrix(rows, rows);
+        double trace = 0.;
+        for (size_t i = 0; i < rows; ++i) {
+            trace += square[i][i];
+        }
+        ASSERT_TRUE_MSG(fabs(square.trace() - trace) < EPS, "SIMD trace")
+
+        auto close = mat1;
+        close[rows - 1][cols - 1] += EPS / 2;
+        ASSERT_TRUE_MSG(close == mat1, "SIMD operator ==")
+        close[rows - 1][cols - 1] += EPS * 2;
+        ASSERT_TRUE_MSG(close != mat1, "SIMD operator ==")
+    }
+    task::set_simd_level(task::max_simd_level());
+
+    {
+        // The level may change while another thread runs the kernels.
+        auto mat1 = RandomMatrix(30, 30);
+        auto mat2 = RandomMatrix(30, 30);
+        Matrix expected = mat1 + mat2;
+        std::atomic<bool> done(false);
+        std::thread switcher([&] {
+            while (!done) {
+                for (auto level : {task::SimdLevel::Scalar, task::SimdLevel::SSE2, task::SimdLevel::AVX2})
+                    task::set_simd_level(level);
+            }
+        });
+        bool same = true;
+        for (int i = 0; i < 200; ++i) {
+            Matrix sum = mat1 + mat2;
+            same = same && sum == expected && task::simd_level() <= task::max_simd_level();
+        }
+        done = true;
+        switcher.join();
+        ASSERT_TRUE_MSG(same, "Concurrent set_simd_level")
+        task::set_simd_level(task::max_simd_level());
+    }
+
+    REPEAT(10) {
+        // Odd sizes exercise the peeling of the last row, column and inner index.
+        auto rows = RandomUInt(1, 100), inner = RandomUInt(1, 100), cols = RandomUInt(1, 100);
+        auto mat1 = RandomMatrix(rows, inner);
+        auto mat2 = RandomMatrix(inner, cols);
+        Matrix classical = mat1 * mat2;
+        task::set_product_algorithm(task::ProductAlgorithm::Strassen, 8);
+        Matrix strassen = mat1 * mat2;
+        task::set_product_algorithm(task::ProductAlgorithm::Classical);
+        ASSERT_TRUE_MSG(strassen == classical, "Strassen product")
+    }
+
+    {
+        // The algorithm may change while another thread multiplies.
+        auto mat1 = RandomMatrix(40, 40);
+        auto mat2 = RandomMatrix(40, 40);
+        Matrix expected = mat1 * mat2;
+        std::atomic<bool> done(false);
+        std::thread switcher([&] {
+            while (!done) {
+                task::set_product_algorithm(task::ProductAlgorithm::Strassen, 8);
+                task::set_product_algorithm(task::ProductAlgorithm::Classical);
+            }
+        });
+        bool same = true;
+        for (int i = 0; i < 50; ++i) {
+            same = same && mat1 * mat2 == expected;
+        }
+        done = true;
+        switcher.join();
+        ASSERT_TRUE_MSG(same, "Concurrent set_product_algorithm")
+    }
+
+    for (auto policy : {task::Accumulation::Widened, task::Accumulation::Kahan, task::Accumulation::Pairwise}) {
+        auto rows = RandomUInt(1, 60), inner = RandomUInt(1, 300), cols = RandomUInt(1, 300);
+        auto mat1 = RandomMatrix(rows, inner);
+        auto mat2 = RandomMatrix(inner, cols);
+        auto square = RandomMatrix(inner, inner);
+        task::MatrixF float1(mat1), float2(mat2);
+        Matrix plain = mat1 * mat2;
+        double plain_trace = square.trace();
+        task::MatrixF float_plain = float1 * float2;
+
+        task::set_accumulation(policy);
+        ASSERT_TRUE_MSG(mat1 * mat2 == plain, "Accumulation policy product")
+        ASSERT_TRUE_MSG(fabs(square.trace() - plain_trace) < EPS, "Accumulation policy trace()")
+        task::MatrixF float_product = float1 * float2;
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                ASSERT_TRUE_MSG(fabs(float_product(i, j) - float_plain(i, j)) < 1e-2, "Accumulation policy MatrixF")
+            }
+        }
+
+        // Many terms that plain double summation drops next to a large one.
+        if (policy != task::Accumulation::Widened) {
+            Matrix small(1000, 1000), row(1, 1000), ones(1000, 1);
+            for (size_t i = 0; i < 1000; ++i) {
+                small[i][i] = row[0][i] = i == 999 ? 1. : 1e-16;
+                ones[i][0] = 1.;
+            }
+            ASSERT_TRUE_MSG(fabs(small.trace() - (1. + 999e-16)) < 1e-15, "Compensated trace()")
+            ASSERT_TRUE_MSG(fabs((row * ones).get(0, 0) - (1. + 999e-16)) < 1e-15, "Compensated product")
+        }
+        task::set_accumulation(task::Accumulation::Plain);
+    }
+
+    {
+        // The policy may change while another thread multiplies.
+        auto mat1 = RandomMatrix(30, 50);
+        auto mat2 = RandomMatrix(50, 30);
+        Matrix expected = mat1 * mat2;
+        double expected_trace = expected.trace();
+        std::atomic<bool> done(false);
+        std::thread switcher([&] {
+            while (!done) {
+                for (auto policy : {task::Accumulation::Kahan, task::Accumulation::Pairwise, task::Accumulation::Plain})
+                    task::set_accumulation(policy);
+            }
+        });
+        bool same = true;
+        for (int i = 0; i < 50; ++i) {
+            Matrix product = mat1 * mat2;
+            same = same && product == expected && fabs(product.trace() - expected_trace) < EPS;
+        }
+        done = true;
+        switcher.join();
+        ASSERT_TRUE_MSG(same, "Concurrent set_accumulation")
+    }
+
+    {
+        auto mat1 = RandomMatrix(300, 200);
+        auto mat2 = RandomMatrix(200, 250);
+        auto square = RandomMatrix(200, 200);
+
+        Matrix product = mat1 * mat2, transposed = mat1.transposed(), sum = mat1 * 2. - mat1;
+        double det = square.det();
+
+        for (size_t threads : {2, 3, 4}) {
+            task::set_num_threads(threads);
+            ASSERT_TRUE_MSG(task::num_threads() == threads, "set_num_threads()")
+            Matrix parallel_product = mat1 * mat2;
+            Matrix parallel_transposed = mat1.transposed();
+            Matrix parallel_sum = mat1 * 2. - mat1;
+            for (size_t i = 0; i < product.rows(); ++i) {
+                for (size_t j = 0; j < product.cols(); ++j) {
+                    ASSERT_TRUE_MSG(parallel_product[i][j] == product[i][j], "Parallel operator *")
+                }
+            }
+            ASSERT_TRUE_MSG(parallel_transposed == transposed, "Parallel transposed()")
+            ASSERT_TRUE_MSG(parallel_sum == sum, "Parallel element-wise operators")
+            ASSERT_TRUE_MSG(square.det() == det, "Parallel det()")
+            ASSERT_TRUE_MSG(!(parallel_sum != mat1), "Parallel operator ==")
+        }
+
+        // Products from two application threads share the pool while a third
+        // one keeps replacing it.
+        task::set_num_threads(4);
+        Matrix square_product = square * square;
+        std::atomic<bool> concurrent_ok(true);
+        auto products = [&] {
+            for (int i = 0; i < 5; ++i) {
+                Matrix result = square * square;
+                if (result != square_product)
+                    concurrent_ok = false;
+            }
+        };
+        std::thread first(products), second(products);
+        std::thread resizer([] {
+            for (size_t threads : {2, 3, 4, 2, 1, 4}) {
+                task::set_num_threads(threads);
+                std::this_thread::yield();
+            }
+        });
+        first.join();
+        second.join();
+        resizer.join();
+        ASSERT_TRUE_MSG(concurrent_ok, "Concurrent parallel products")
+
+        task::set_num_threads(4);
+        bool thrown = false;
+        try {
+            task::detail::parallel_for(1000, 1, [](size_t begin, size_t) {
+                if (begin > 0)
+                    throw std::runtime_error("task");
+            });
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT_TRUE_MSG(thrown, "Exception from a pool task")
+        ASSERT_TRUE_MSG(mat1 * mat2 == product, "Pool after an exception")
+        task::set_num_threads(1);
+    }
+
+    // Shapes around the packing edges: MR = 4 and NR = 8 for the micro-kernel,
+    // MC = 96, KC = 256 and NC = 2048 for the blocks, on strided operands
+    // with padding that must be neither read nor written.
+    for (auto shape : {std::make_tuple(97, 257, 9), std::make_tuple(96, 256, 8), std::make_tuple(1, 1, 1),
+                       std::make_tuple(5, 513, 17), std::make_tuple(193, 300, 33), std::make_tuple(3, 7, 2049),
+                       std::make_tuple(4, 255, 7)}) {
+        size_t m = std::get<0>(shape), k = std::get<1>(shape), n = std::get<2>(shape);
+        size_t lda = k + RandomUInt(0, 3), ldb = n + RandomUInt(0, 3), ldc = n + 5;
+        std::vector<double> a(m * lda), b(k * ldb), c(m * ldc, 7.), expected(m * n);
+        for (double& value : a) {
+            value = RandomDouble();
+        }
+        for (double& value : b) {
+            value = RandomDouble();
+        }
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                for (size_t p = 0; p < k; ++p) {
+                    expected[i * n + j] += a[i * lda + p] * b[p * ldb + j];
+                }
+            }
+        }
+        for (size_t threads : {1, 3}) {
+            task::set_num_threads(threads);
+            std::fill(c.begin(), c.end(), 7.);
+            if (threads == 1) {
+                task::detail::gemm(m, n, k, a.data(), lda, b.data(), ldb, c.data(), ldc);
+            } else {
+                task::detail::parallel_gemm(m, n, k, a.data(), lda, b.data(), ldb, c.data(), ldc);
+            }
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < ldc; ++j) {
+                    if (j < n) {
+                        ASSERT_TRUE_MSG(fabs(c[i * ldc + j] - expected[i * n + j]) < 1e-9 * k, "gemm edge shapes")
+                    } else {
+                        ASSERT_TRUE_MSG(c[i * ldc + j] == 7., "gemm writes past n")
+                    }
+                }
+            }
+        }
+        task::set_num_threads(1);
+    }
+
+    for (auto shape : {std::make_pair(1, 70), std::make_pair(70, 1), std::make_pair(97, 97),
+                       std::make_pair(300, 7), std::make_pair(33, 130)}) {
+        auto mat = RandomMatrix(shape.first, shape.second);
+        auto transposed = mat.transposed();
+        auto in_place = mat;
+        in_place.transpose();
+
+        ASSERT_TRUE_MSG(transposed.rows() == mat.cols() && transposed.cols() == mat.rows(), "transposed()")
+        for (size_t i = 0; i < mat.rows(); ++i) {
+            for (size_t j = 0; j < mat.cols(); ++j) {
+                ASSERT_TRUE_MSG(transposed[j][i] == mat[i][j], "transposed()")
+            }
+        }
+        ASSERT_TRUE_MSG(in_place == transposed, "transpose()")
+
+        in_place.transpose();
+        ASSERT_TRUE_MSG(in_place == mat, "transpose()")
+    }
+
+    {
+        auto mat = RandomMatrix(40, 30);
+        const Matrix& mat_c = mat;
+
+        auto row = mat.row_view(5);
+        auto column = mat_c.column_view(7);
+        ASSERT_TRUE_MSG(row.size() == 30 && column.size() == 40, "Row / column views")
+        row[7] = 123.;
+        ASSERT_TRUE_MSG(mat[5][7] == 123. && column[5] == 123., "Row / column views")
+        ASSERT_EXCEPTION_MSG(mat.row_view(40), task::OutOfBoundsException, "Row / column views")
+
+        auto block = mat.block(10, 5, 20, 15);
+        ASSERT_TRUE_MSG(block(0, 0) == mat[10][5] && block(19, 14) == mat[29][19], "Block view")
+        ASSERT_EXCEPTION_MSG(mat.block(30, 0, 11, 1), task::OutOfBoundsException, "Block view")
+
+        Matrix copy = block;
+        ASSERT_TRUE_MSG(copy.rows() == 20 && copy.cols() == 15 && copy == block, "Block view")
+        ASSERT_TRUE_MSG(block * 2. - copy == copy, "Block view arithmetic")
+
+        auto other = RandomMatrix(20, 15);
+        block += other;
+        copy += other;
+        ASSERT_TRUE_MSG(mat.block(10, 5, 20, 15) == copy, "Block view +=")
+        ASSERT_TRUE_MSG(mat[9][5] == mat_c.view()(9, 5), "Block view +=")
+
+        auto lhs = mat.block(0, 0, 12, 30);
+        auto rhs = RandomMatrix(40, 50);
+        Matrix expected = Matrix(lhs) * rhs.block(10, 0, 30, 9);
+        ASSERT_TRUE_MSG(lhs * rhs.block(10, 0, 30, 9) == expected, "Product of views")
+
+        Matrix out(20, 20);
+        size_t before = allocation_count;
+        task::multiply(lhs, rhs.block(10, 0, 30, 9), out.block(4, 3, 12, 9));
+        ASSERT_TRUE_MSG(allocation_count - before <= 2, "Product into a view")
+        ASSERT_TRUE_MSG(out.block(4, 3, 12, 9) == expected && out[0][0] == 1., "Product into a view")
+
+        auto first = mat_c.column_view(3), second = mat_c.column_view(4);
+        std::vector<double> sum = first + second, difference = first - second;
+        std::vector<double> scaled = 2. * first, negated = -first;
+        double dot = 0.;
+        for (size_t i = 0; i < 40; ++i) {
+            ASSERT_TRUE_MSG(sum[i] == mat[i][3] + mat[i][4] && difference[i] == mat[i][3] - mat[i][4] &&
+                            scaled[i] == 2. * mat[i][3] && negated[i] == -mat[i][3], "Strided vector arithmetic")
+            dot += mat[i][3] * mat[i][4];
+        }
+        ASSERT_TRUE_MSG(task::dot(first, second) == dot, "Strided vector dot product")
+        ASSERT_EXCEPTION_MSG(first + mat_c.row_view(0), task::SizeMismatchException, "Strided vector arithmetic")
+
+        auto square = RandomMatrix(30, 30);
+        std::vector<double> product = square * mat_c.row_view(2);
+        ASSERT_TRUE_MSG(product.size() == 30, "Matrix-vector product")
+        for (size_t i = 0; i < 30; ++i) {
+            ASSERT_TRUE_MSG(fabs(product[i] - task::dot(square.row_view(i), mat_c.row_view(2))) < EPS,
+                            "Matrix-vector product")
+        }
+        ASSERT_TRUE_MSG(first.as_column() * 2. == Matrix(first.as_column()) + Matrix(first.as_column()),
+                        "Strided vector as a column")
+
+        Matrix target = mat;
+        target.column_view(0) = mat_c.column_view(1);
+        target.column_view(0) += mat_c.column_view(2);
+        target.column_view(0) -= mat_c.column_view(3);
+        target.column_view(0) *= 0.5;
+        auto target_row = target.row_view(1);
+        target_row = target.row_view(2);
+        for (size_t i = 0; i < 40; ++i) {
+            ASSERT_TRUE_MSG(target[i][0] == (mat[i][1] + mat[i][2] - mat[i][3]) * 0.5 || i == 1,
+                            "Strided vector assignments")
+        }
+        for (size_t j = 0; j < 30; ++j) {
+            ASSERT_TRUE_MSG(target[1][j] == target[2][j], "Strided vector assignments")
+        }
+    }
+
+    {
+        auto mat = RandomMatrix(70, 45);
+        std::stringstream stream;
+        task::write_binary(stream, mat);
+        ASSERT_TRUE_MSG(stream.str().size() == sizeof(task::MatrixFileHeader) + 70 * 45 * sizeof(double),
+                        "Binary output")
+        ASSERT_TRUE_MSG(task::read_binary(stream) == mat, "Binary input")
+
+        std::stringstream garbage("not a matrix at all, definitely not one with a header");
+        ASSERT_EXCEPTION_MSG(task::read_binary(garbage), task::IOException, "Binary input")
+
+        const std::string path = "matrix_test.bin";
+        {
+            task::MatrixWriter writer(path, 70, 45);
+            writer.write_rows(mat.block(0, 0, 30, 45));
+            for (size_t i = 30; i < 70; ++i) {
+                writer.write_row(&mat.get(i, 0));
+            }
+            writer.close();
+        }
+        {
+            auto mapped = Matrix::mmap_open(path);
+            ASSERT_TRUE_MSG(mapped.rows() == 70 && mapped.cols() == 45, "mmap_open()")
+            ASSERT_TRUE_MSG(mapped.view() == mat, "mmap_open()")
+            ASSERT_TRUE_MSG(mapped.view() * mat.transposed() == mat * mat.transposed(), "mmap_open()")
+        }
+        {
+            task::MatrixWriter writer(path, 3, 45);
+            writer.write_row(&mat.get(0, 0));
+            ASSERT_EXCEPTION_MSG(writer.close(), task::IOException, "MatrixWriter")
+        }
+
+        // Crafted headers: shapes whose size in bytes wraps around, and
+        // alignments that are not a power of two dividing data_offset.
+        std::stringstream valid;
+        task::write_binary(valid, mat);
+        for (int variant = 0; variant < 4; ++variant) {
+            std::string bytes = valid.str();
+            task::MatrixFileHeader header;
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            if (variant == 0) {
+                header.rows = uint64_t(1) << 61;
+                header.cols = 8;
+            } else if (variant == 1) {
+                header.rows = uint64_t(1) << 32;
+                header.cols = uint64_t(1) << 32;
+            } else if (variant == 2) {
+                header.alignment = 48;
+            } else {
+                header.alignment = 128;
+            }
+            std::memcpy(&bytes[0], &header, sizeof(header));
+            std::stringstream crafted(bytes);
+            ASSERT_EXCEPTION_MSG(task::read_binary(crafted), task::IOException, "Crafted binary header")
+            std::ofstream(path, std::ios::binary) << bytes;
+            ASSERT_EXCEPTION_MSG(Matrix::mmap_open(path), task::IOException, "Crafted mmap_open() header")
+        }
+
+        // A valid header over a truncated payload, from a file and from a
+        // stream that cannot seek, fails without allocating the claimed size.
+        {
+            std::string bytes = valid.str();
+            task::MatrixFileHeader header;
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            header.rows = uint64_t(1) << 28;
+            header.cols = 64;
+            std::memcpy(&bytes[0], &header, sizeof(header));
+            std::ofstream(path, std::ios::binary) << bytes;
+            ASSERT_EXCEPTION_MSG(task::read_binary(path), task::IOException, "Truncated binary input")
+            PipeBuf pipe(bytes);
+            std::istream piped(&pipe);
+            ASSERT_EXCEPTION_MSG(task::read_binary(piped), task::IOException, "Truncated binary input")
+            PipeBuf short_pipe(valid.str().substr(0, valid.str().size() - 8));
+            std::istream short_piped(&short_pipe);
+            ASSERT_EXCEPTION_MSG(task::read_binary(short_piped), task::IOException, "Truncated binary input")
+        }
+        {
+            auto large = RandomMatrix(400, 400);
+            std::stringstream written;
+            task::write_binary(written, large);
+            PipeBuf pipe(written.str());
+            std::istream piped(&pipe);
+            ASSERT_TRUE_MSG(task::read_binary(piped) == large, "Binary input from a pipe")
+        }
+
+        std::remove(path.c_str());
+        ASSERT_EXCEPTION_MSG(Matrix::mmap_open(path), task::IOException, "mmap_open()")
+    }
+
+    {
+        constexpr task::FixedMatrix<int, 3, 3> identity;
+        static_assert(identity.det() == 1 && identity.trace() == 3, "constexpr FixedMatrix");
+        static_assert((identity * 2 + identity).det() == 27, "constexpr FixedMatrix");
+        static_assert((2.0 * task::Matrix3f()).trace() == 6.f && (task::Matrix3f() * 2.0).trace() == 6.f,
+                      "Scalar * FixedMatrix<float>");
+
+        auto mat3 = RandomMatrix(3, 3), mat4 = RandomMatrix(4, 4), mat6 = RandomMatrix(6, 6);
+        auto other4 = RandomMatrix(4, 4);
+        auto fixed3 = task::Matrix3d::from(mat3);
+        auto fixed4 = task::Matrix4d::from(mat4);
+        auto fixed6 = task::FixedMatrix<double, 6, 6>::from(mat6);
+        auto other_fixed4 = task::Matrix4d::from(other4);
+
+        ASSERT_TRUE_MSG(fabs(fixed3.det() - mat3.det()) < EPS, "FixedMatrix det()")
+        ASSERT_TRUE_MSG(fabs(fixed4.det() - mat4.det()) < EPS * 10., "FixedMatrix det()")
+        ASSERT_TRUE_MSG(fabs(fixed6.det() - mat6.det()) < EPS * fabs(mat6.det()), "FixedMatrix det()")
+        ASSERT_TRUE_MSG((fixed4 * other_fixed4).to_matrix() == mat4 * other4, "FixedMatrix operator *")
+        ASSERT_TRUE_MSG((fixed4 * 2. - other_fixed4).to_matrix() == mat4 * 2. - other4, "FixedMatrix arithmetic")
+        ASSERT_TRUE_MSG(fixed3.transposed().to_matrix() == mat3.transposed(), "FixedMatrix transposed()")
+        ASSERT_TRUE_MSG(fabs(fixed4.trace() - mat4.trace()) < EPS, "FixedMatrix trace()")
+        ASSERT_EXCEPTION_MSG(task::Matrix3d::from(mat4), task::SizeMismatchException, "FixedMatrix from()")
+
+        task::FixedMatrix<long long, 5, 5> integer;
+        task::MatrixI64 dynamic_integer(5, 5);
+        for (size_t i = 0; i < 5; ++i) {
+            for (size_t j = 0; j < 5; ++j) {
+                integer(i, j) = static_cast<long long>(RandomUInt(0, 20)) - 10;
+                dynamic_integer(i, j) = integer(i, j);
+            }
+        }
+        auto integer_det = integer.det();
+        ASSERT_TRUE_MSG(fabs(integer_det - integer.to_matrix().det()) < 1e-6 * (1. + fabs(integer_det)),
+                        "Integer det()")
+        ASSERT_TRUE_MSG(dynamic_integer.det() == integer_det, "Integer det()")
+
+        task::MatrixF single(mat4);
+        task::MatrixF single_other(other4);
+        auto single_product = (single * single_other).to_matrix();
+        auto product = mat4 * other4;
+        for (size_t i = 0; i < 4; ++i) {
+            for (size_t j = 0; j < 4; ++j) {
+                ASSERT_TRUE_MSG(fabs(single_product[i][j] - product[i][j]) < 1e-3, "BasicMatrix<float> operator *")
+            }
+        }
+        ASSERT_TRUE_MSG(fabs(single.det() - mat4.det()) < 1e-2, "BasicMatrix<float> det()")
+        auto single_difference = single - single_other;
+        for (size_t i = 0; i < 4; ++i) {
+            for (size_t j = 0; j < 4; ++j) {
+                float expected = static_cast<float>(mat4[i][j]) - static_cast<float>(other4[i][j]);
+                ASSERT_TRUE_MSG(single_difference(i, j) == expected, "BasicMatrix<float> operator -")
+            }
+        }
+        auto single_doubled = 2.0 * single;
+        ASSERT_TRUE_MSG(single_doubled(1, 2) == single(1, 2) * 2.f, "Scalar * BasicMatrix<float>")
+        ASSERT_EXCEPTION_MSG(single.get(4, 0), task::OutOfBoundsException, "BasicMatrix get()")
+    }
+
+
+    REPEAT(10) {
+        auto rows = RandomUInt(1, 60);
+        auto inner = RandomUInt(1, 60);
+        auto cols = RandomUInt(1, 60);
+        auto dense = RandomMatrix(rows, inner);
+        auto other = RandomMatrix(inner, cols);
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < inner; ++j) {
+                if (RandomUInt(0, 9) != 0) {
+                    dense[i][j] = 0;
+                }
+            }
+        }
+        task::CsrMatrix sparse(dense);
+        task::CsrMatrix sparse_other(other, 5.);
+        ASSERT_TRUE_MSG(sparse.to_matrix() == dense, "CsrMatrix conversion")
+        ASSERT_TRUE_MSG(sparse.to_coo().to_csr().to_matrix() == dense, "CooMatrix conversion")
+        ASSERT_TRUE_MSG(sparse.transposed().to_matrix() == dense.transposed(), "CsrMatrix transposed()")
+        ASSERT_TRUE_MSG(sparse * other == dense * other, "Sparse-dense product")
+        ASSERT_TRUE_MSG(dense.transposed() * sparse == dense.transposed() * dense, "Dense-sparse product")
+        ASSERT_TRUE_MSG((sparse * sparse_other).to_matrix() == dense * sparse_other.to_matrix(),
+                        "Sparse-sparse product")
+
+        std::vector<double> x(inner);
+        Matrix column(inner, 1);
+        for (size_t i = 0; i < inner; ++i) {
+            x[i] = column[i][0] = RandomDouble();
+        }
+        auto y = sparse * x;
+        auto expected = dense * column;
+        for (size_t i = 0; i < rows; ++i) {
+            ASSERT_TRUE_MSG(fabs(y[i] - expected[i][0]) < task::EPS, "Sparse matrix-vector product")
+        }
+
+        auto row = RandomUInt(0, rows - 1);
+        auto col = RandomUInt(0, inner - 1);
+        ASSERT_TRUE_MSG(sparse.get(row, col) == dense[row][col], "CsrMatrix get()")
+        ASSERT_EXCEPTION_MSG(sparse.get(rows, 0), task::OutOfBoundsException, "CsrMatrix get()")
+        if (rows != inner) {
+            ASSERT_EXCEPTION_MSG(sparse * sparse, task::SizeMismatchException, "Sparse-sparse product")
+        }
+    }
+
+    {
+        task::CooMatrix coo(3, 4);
+        coo.add(2, 1, 1.5);
+        coo.add(0, 3, 2.);
+        coo.add(2, 1, 0.5);
+        coo.add(0, 0, -1.);
+        task::CsrMatrix csr = coo.to_csr();
+        ASSERT_TRUE_MSG(csr.nnz() == 3, "CooMatrix duplicates")
+        ASSERT_TRUE_MSG(csr.get(2, 1) == 2. && csr.get(0, 3) == 2. && csr.get(0, 0) == -1.,
+                        "CooMatrix duplicates")
+        ASSERT_TRUE_MSG(csr.get(1, 1) == 0., "CsrMatrix zeros")
+        ASSERT_EXCEPTION_MSG(coo.add(3, 0, 1.), task::OutOfBoundsException, "CooMatrix add()")
+        ASSERT_EXCEPTION_MSG(task::CsrMatrix(2, 2, {0, 1, 1}, {2}, {1.}), task::SizeMismatchException,
+                             "CsrMatrix validation")
+    }
+
+    for (auto level : {task::SimdLevel::Scalar, task::SimdLevel::AVX2}) {
+        task::set_simd_level(level);
+        size_t count = RandomUInt(1, 20), n = RandomUInt(1, 8), cols = RandomUInt(1, 8);
+        task::MatrixBatch square(count, n, n), other(count, n, cols);
+        std::vector<Matrix> squares, others;
+        for (size_t i = 0; i < count; ++i) {
+            squares.push_back(RandomMatrix(n, n));
+            others.push_back(RandomMatrix(n, cols));
+            square.set(i, squares[i]);
+            other.set(i, others[i]);
+        }
+        // A singular matrix among them: the first row repeated.
+        if (n > 1) {
+            for (size_t j = 0; j < n; ++j) {
+                squares[0][n - 1][j] = squares[0][0][j];
+            }
+            square.set(0, squares[0]);
+        }
+
+        auto product = square * other;
+        auto transposed = other.transposed();
+        auto det = square.det();
+        auto trace = square.trace();
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE_MSG(product.get(i) == squares[i] * others[i], "MatrixBatch operator *")
+            ASSERT_TRUE_MSG(transposed.get(i) == others[i].transposed(), "MatrixBatch transposed()")
+            ASSERT_TRUE_MSG(fabs(det[i] - squares[i].det()) < EPS * (1. + fabs(det[i])), "MatrixBatch det()")
+            ASSERT_TRUE_MSG(fabs(trace[i] - squares[i].trace()) < EPS, "MatrixBatch trace()")
+        }
+        ASSERT_TRUE_MSG(n == 1 || fabs(det[0]) < EPS, "MatrixBatch det() of a singular matrix")
+        ASSERT_TRUE_MSG(task::MatrixBatch(count, n, n).get(count - 1) == Matrix(n, n), "MatrixBatch identity")
+        ASSERT_EXCEPTION_MSG(square * task::MatrixBatch(count + 1, n, n), task::SizeMismatchException,
+                             "MatrixBatch operator *")
+        ASSERT_EXCEPTION_MSG(square.get(count), task::OutOfBoundsException, "MatrixBatch get()")
+    }
+    task::set_simd_level(task::max_simd_level());
+
+    {
+        // Triangular matrices have the product of the diagonal as determinant,
+        // shuffling the rows only changes the sign.
+        Matrix mat(60, 60);
+        double expected = 1.;
+        for (size_t i = 0; i < 60; ++i) {
+            mat[i][i] = (i % 3 == 0) ? 2. : -0.75;
+            expected *= mat[i][i];
+            for (size_t j = i + 1; j < 60; ++j) {
+                mat[i][j] = RandomDouble();
+            }
+        }
+        ASSERT_TRUE_MSG(fabs(mat.det() - expected) < EPS * fabs(expected), "Determinant")
+
+        auto swapped = mat;
+        for (size_t j = 0; j < 60; ++j) {
+            std::swap(swapped[0][j], swapped[59][j]);
+        }
+        ASSERT_TRUE_MSG(fabs(swapped.det() + expected) < EPS * fabs(expected), "Determinant")
+
+        Matrix singular(3, 3);
+        for (size_t i = 0; i < 3; ++i) {
+            for (size_t j = 0; j < 3; ++j) {
+                singular[i][j] = i * 3. + j + 1.;
+            }
+        }
+        ASSERT_TRUE_MSG(fabs(singular.det()) < EPS, "Determinant")
+    }
+
+    REPEAT(10)
+    {
+        size_t n = RandomUInt(1, 50);
+        auto mat = RandomMatrix(n, n);
+        auto lu = mat.lu();
+        const auto& factors = lu.factors();
+        const auto& perm = lu.permutation();
+
+        Matrix lower(n, n), upper(n, n), permuted(n, n);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                lower[i][j] = i > j ? factors[i][j] : (i == j ? 1. : 0.);
+                upper[i][j] = i <= j ? factors[i][j] : 0.;
+                permuted[i][j] = mat[perm[i]][j];
+            }
+        }
+        ASSERT_TRUE_MSG(lower * upper == permuted, "LU decomposition")
+        ASSERT_TRUE_MSG(fabs(lu.det() - mat.det()) < EPS, "LU decomposition")
+    }
+
+    REPEAT(10)
+    {
+        size_t n = RandomUInt(1, 50), k = RandomUInt(1, 20);
+        auto mat = RandomMatrix(n, n);
+        auto rhs = RandomMatrix(n, k);
+        auto lu = mat.lu();
+        ASSERT_TRUE_MSG(mat * lu.solve(rhs) == rhs, "LU solve()")
+        ASSERT_TRUE_MSG(mat * mat.solve(rhs) == rhs, "Matrix solve()")
+        ASSERT_TRUE_MSG(mat * mat.inverse() == Matrix(n, n), "Matrix inverse()")
+
+        std::vector<double> b(n);
+        for (size_t i = 0; i < n; ++i) {
+            b[i] = rhs[i][0];
+        }
+        auto x = lu.solve(b);
+        auto column = lu.solve(rhs.block(0, 0, n, 1));
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_TRUE_MSG(x[i] == column[i][0], "LU solve() of a vector")
+        }
+
+        // G^T G + n I is symmetric positive definite.
+        auto g = RandomMatrix(n, n);
+        Matrix spd = g.transposed() * g + Matrix(n, n) * double(n);
+        auto cholesky = spd.cholesky();
+        const auto& l = cholesky.factor();
+        ASSERT_TRUE_MSG(l * l.transposed() == spd, "Cholesky decomposition")
+        ASSERT_TRUE_MSG(spd * cholesky.solve(rhs) == rhs, "Cholesky solve()")
+        ASSERT_TRUE_MSG(spd * cholesky.inverse() == Matrix(n, n), "Cholesky inverse()")
+        ASSERT_TRUE_MSG(fabs(cholesky.det() - spd.det()) < EPS * fabs(spd.det()), "Cholesky det()")
+
+        ASSERT_EXCEPTION_MSG(lu.solve(RandomMatrix(n + 1, k)), task::SizeMismatchException, "LU solve()")
+        ASSERT_EXCEPTION_MSG(Matrix(spd * -1.).cholesky(), task::NotPositiveDefiniteException, "Cholesky")
+    }
+
+    {
+        // The second row is twice the first.
+        Matrix singular(3, 3);
+        for (size_t j = 0; j < 3; ++j) {
+            singular[0][j] = double(j + 1);
+            singular[1][j] = double(2 * (j + 1));
+            singular[2][j] = 1.;
+        }
+        ASSERT_TRUE_MSG(singular.lu().singular(), "LU singular()")
+        ASSERT_EXCEPTION_MSG(singular.solve(Matrix(3, 1)), task::SingularMatrixException, "Matrix solve()")
+        ASSERT_EXCEPTION_MSG(singular.inverse(), task::SingularMatrixException, "Matrix inverse()")
+    }
+
     REPEAT(100)
     {
         auto mat1 = RandomMatrix(100, 50);
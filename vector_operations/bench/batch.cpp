@@ -0,0 +1,54 @@
+#include <cstdint>
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/vector_batch.h"
+
+
+// Cross products and parallelism checks for count pairs of 3D vectors, one
+// std::vector per vector against the VectorBatch3 forms.
+int main() {
+    using namespace task;
+    std::printf("doubles, ns per vector pair\n");
+    std::printf("%10s %10s %10s %9s %10s %10s %9s\n", "count", "a % b", "batch", "speedup", "a || b", "batch",
+                "speedup");
+    for (std::size_t count : {1000, 100000, 1000000, 4000000}) {
+        std::vector<std::vector<double>> vecs, vecs2;
+        VectorBatch3<double> batch, batch2;
+        for (std::size_t i = 0; i < count; ++i) {
+            vecs.push_back(RandomVector<double>(3));
+            vecs2.push_back(RandomVector<double>(3));
+            batch.push_back(vecs.back());
+            batch2.push_back(vecs2.back());
+        }
+        double min_seconds = count >= 1000000 ? 0 : 0.2;
+
+        std::vector<std::vector<double>> crosses(count);
+        double cross = BestTime([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                crosses[i] = vecs[i] % vecs2[i];
+            }
+            DoNotOptimize(crosses);
+        }, min_seconds);
+        VectorBatch3<double> batch_crosses;
+        double batch_cross = BestTime([&] {
+            task::cross(batch_crosses, batch, batch2);
+            DoNotOptimize(batch_crosses);
+        }, min_seconds);
+
+        std::vector<std::uint8_t> checks(count);
+        double check = BestTime([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                checks[i] = vecs[i] || vecs2[i];
+            }
+            DoNotOptimize(checks);
+        }, min_seconds);
+        double batch_check = BestTime([&] {
+            task::parallel(checks, batch, batch2);
+            DoNotOptimize(checks);
+        }, min_seconds);
+
+        std::printf("%10zu %10.2f %10.2f %8.2fx %10.2f %10.2f %8.2fx\n", count, cross / count * 1e9,
+                    batch_cross / count * 1e9, cross / batch_cross, check / count * 1e9,
+                    batch_check / count * 1e9, check / batch_check);
+    }
+}
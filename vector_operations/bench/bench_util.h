@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+
+// Runs fn repeatedly for at least min_seconds (and at least three times) and
+// returns the best time of a single run in seconds.
+template <class Fn>
+double BestTime(Fn fn, double min_seconds = 0.2) {
+    using Clock = std::chrono::steady_clock;
+    double best = 1e300;
+    double total = 0;
+    int runs = 0;
+    while (total < min_seconds || runs < 3) {
+        auto start = Clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        best = elapsed < best ? elapsed : best;
+        total += elapsed;
+        runs++;
+    }
+    return best;
+}
+
+// Keeps the optimizer from discarding a computed value.
+template <class T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+template <class T>
+std::vector<T> RandomVector(std::size_t size) {
+    static std::mt19937 rand(42);
+    std::uniform_int_distribution<int> dist{-100, 100};
+    std::vector<T> result(size);
+    for (auto& item : result) {
+        item = T(dist(rand));
+    }
+    return result;
+}
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/vector_bits.h"
+#include "src/vector_ops.h"
+
+
+task::BitVector RandomBits(std::size_t size) {
+    static std::uint64_t state = 42;
+    task::BitVector bits(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        bits.set(i, state & 1);
+    }
+    return bits;
+}
+
+
+// Masks as std::vector<int> and as BitVector. The std::vector<int> columns
+// stop at 10^8 elements, where a mask already takes 400 MB.
+int main() {
+    using namespace task;
+    std::printf("ns per 1000 elements\n");
+    std::printf("%12s %10s %10s %10s %10s %10s %10s %10s\n", "size", "int |", "bits |", "bits |=", "int count",
+                "bits count", "int rev", "bits rev");
+    for (std::size_t size : {1000, 1000000, 100000000, 1000000000}) {
+        BitVector a = RandomBits(size), b = RandomBits(size);
+        double min_seconds = size >= 100000000 ? 0 : 0.2;
+        double per = 1e12 / size;
+        double int_or = 0, int_count = 0, int_reverse = 0;
+        if (size <= 100000000) {
+            std::vector<int> x(a), y(b);
+            int_or = BestTime([&] {
+                std::vector<int> result = x | y;
+                DoNotOptimize(result);
+            }, min_seconds);
+            int_count = BestTime([&] {
+                std::size_t count = 0;
+                for (int value : x) {
+                    count += value != 0;
+                }
+                DoNotOptimize(count);
+            }, min_seconds);
+            int_reverse = BestTime([&] {
+                reverse(x);
+                DoNotOptimize(x);
+            }, min_seconds);
+        }
+        double bits_or = BestTime([&] {
+            BitVector result = a | b;
+            DoNotOptimize(result);
+        }, min_seconds);
+        BitVector c = a;
+        double bits_or_assign = BestTime([&] {
+            c |= b;
+            DoNotOptimize(c);
+        }, min_seconds);
+        double bits_count = BestTime([&] {
+            std::size_t count = a.count();
+            DoNotOptimize(count);
+        }, min_seconds);
+        double bits_reverse = BestTime([&] {
+            reverse(a);
+            DoNotOptimize(a);
+        }, min_seconds);
+        auto column = [&](double seconds) {
+            if (seconds == 0) {
+                std::printf(" %10s", "-");
+            } else {
+                std::printf(" %10.1f", seconds * per);
+            }
+        };
+        std::printf("%12zu", size);
+        for (double seconds : {int_or, bits_or, bits_or_assign, int_count, bits_count, int_reverse, bits_reverse}) {
+            column(seconds);
+        }
+        std::printf("\n");
+    }
+}
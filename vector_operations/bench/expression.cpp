@@ -0,0 +1,49 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/vector_ops.h"
+
+
+// a + b - c the way the operators used to evaluate it: a temporary for
+// a + b, another for -c and the result of their sum.
+std::vector<double> Eager(const std::vector<double>& a, const std::vector<double>& b,
+                          const std::vector<double>& c) {
+    std::vector<double> sum(a.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        sum[i] = a[i] + b[i];
+    }
+    std::vector<double> negated(c.size());
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        negated[i] = -c[i];
+    }
+    std::vector<double> result(sum.size());
+    for (std::size_t i = 0; i < sum.size(); ++i) {
+        result[i] = sum[i] + negated[i];
+    }
+    return result;
+}
+
+
+int main() {
+    using namespace task;
+    std::printf("a + b - c, ns per element\n");
+    std::printf("%10s %10s %10s %10s %9s\n", "size", "eager", "lazy", "assign", "speedup");
+    for (std::size_t size : {16, 256, 4096, 65536, 1000000, 10000000}) {
+        auto a = RandomVector<double>(size), b = RandomVector<double>(size), c = RandomVector<double>(size);
+        double min_seconds = size >= 10000000 ? 0 : 0.2;
+        double eager = BestTime([&] {
+            auto result = Eager(a, b, c);
+            DoNotOptimize(result);
+        }, min_seconds);
+        double lazy = BestTime([&] {
+            std::vector<double> result = a + b - c;
+            DoNotOptimize(result);
+        }, min_seconds);
+        std::vector<double> out(size);
+        double assigned = BestTime([&] {
+            assign(out, a + b - c);
+            DoNotOptimize(out);
+        }, min_seconds);
+        std::printf("%10zu %10.3f %10.3f %10.3f %8.2fx\n", size, eager / size * 1e9, lazy / size * 1e9,
+                    assigned / size * 1e9, eager / assigned);
+    }
+}
@@ -0,0 +1,33 @@
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/vector_ops.h"
+
+
+// An update loop x = x + k * (a - b) written with operators that return new
+// vectors, and with the in-place and output-parameter forms.
+int main() {
+    using namespace task;
+    std::printf("x = x + 0.5 * (a - b), ns per element\n");
+    std::printf("%10s %10s %10s %9s\n", "size", "by value", "in place", "speedup");
+    for (std::size_t size : {16, 256, 4096, 65536, 1000000, 10000000}) {
+        auto a = RandomVector<double>(size), b = RandomVector<double>(size), x = RandomVector<double>(size);
+        double min_seconds = size >= 10000000 ? 0 : 0.2;
+        double by_value = BestTime([&] {
+            std::vector<double> step = a - b;
+            for (double& value : step) {
+                value *= 0.5;
+            }
+            x = x + step;
+            DoNotOptimize(x);
+        }, min_seconds);
+        std::vector<double> step;
+        double in_place = BestTime([&] {
+            subtract(step, a, b);
+            step *= 0.5;
+            x += step;
+            DoNotOptimize(x);
+        }, min_seconds);
+        std::printf("%10zu %10.3f %10.3f %8.2fx\n", size, by_value / size * 1e9, in_place / size * 1e9,
+                    by_value / in_place);
+    }
+}
@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <thread>
+#include "bench/bench_util.h"
+#include "src/vector_ops.h"
+
+
+// a || b as three separate reductions, the way it used to be computed.
+bool ThreePasses(const std::vector<double>& a, const std::vector<double>& b) {
+    double len2_a = task::length2(a);
+    double len2_b = task::length2(b);
+    if (len2_a != 0 && len2_b != 0) {
+        double dot = task::operator*(a, b);
+        return 1 - dot * dot / (len2_a * len2_b) < task::ERR_EPS;
+    }
+    return true;
+}
+
+
+int main() {
+    using namespace task;
+    unsigned hardware = std::thread::hardware_concurrency();
+    std::printf("doubles, ns per element; threaded uses %u threads\n", hardware);
+    std::printf("%10s %12s %12s %9s %12s %12s %9s\n", "size", "|| 3 passes", "|| fused", "speedup",
+                "dot", "dot threaded", "speedup");
+    for (std::size_t size : {4096, 65536, 1000000, 10000000, 100000000}) {
+        auto a = RandomVector<double>(size), b = RandomVector<double>(size);
+        double min_seconds = size >= 10000000 ? 0 : 0.2;
+        double three_passes = BestTime([&] {
+            bool result = ThreePasses(a, b);
+            DoNotOptimize(result);
+        }, min_seconds);
+        double fused = BestTime([&] {
+            bool result = a || b;
+            DoNotOptimize(result);
+        }, min_seconds);
+        double single = BestTime([&] {
+            double result = a * b;
+            DoNotOptimize(result);
+        }, min_seconds);
+        set_reduction_threads(0);
+        double threaded = BestTime([&] {
+            double result = a * b;
+            DoNotOptimize(result);
+        }, min_seconds);
+        set_reduction_threads(1);
+        std::printf("%10zu %12.3f %12.3f %8.2fx %12.3f %12.3f %8.2fx\n", size, three_passes / size * 1e9,
+                    fused / size * 1e9, three_passes / fused, single / size * 1e9, threaded / size * 1e9,
+                    single / threaded);
+    }
+}
@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <cstdio>
+#include "bench/bench_util.h"
+#include "src/vector_ops.h"
+
+
+using task::SimdLevel;
+
+
+const SimdLevel LEVELS[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+const std::size_t SIZES[] = {16, 256, 4096, 65536, 1000000, 10000000, 100000000};
+
+
+// Nanoseconds per element of fn at every SIMD level. The scalar level runs
+// the plain loops that the operators used before the vector kernels.
+template <class Fn>
+void Row(const char* type, const char* op, std::size_t size, Fn fn) {
+    double times[3];
+    for (int l = 0; l < 3; ++l) {
+        task::set_simd_level(LEVELS[l]);
+        times[l] = BestTime(fn, size >= 10000000 ? 0 : 0.1) / size * 1e9;
+    }
+    task::set_simd_level(task::max_simd_level());
+    std::printf("%-8s %-8s %10zu %10.3f %10.3f %10.3f %8.2fx\n", type, op, size, times[0], times[1],
+                times[2], times[0] / times[2]);
+}
+
+template <class T>
+void Arithmetic(const char* type, std::size_t size) {
+    using namespace task;
+    auto a = RandomVector<T>(size), b = RandomVector<T>(size);
+    Row(type, "a + b", size, [&] {
+        std::vector<T> result = a + b;
+        DoNotOptimize(result);
+    });
+    Row(type, "a - b", size, [&] {
+        std::vector<T> result = a - b;
+        DoNotOptimize(result);
+    });
+    Row(type, "a * b", size, [&] {
+        T result = a * b;
+        DoNotOptimize(result);
+    });
+    Row(type, "length2", size, [&] {
+        double result = length2(a);
+        DoNotOptimize(result);
+    });
+}
+
+void Bitwise(std::size_t size) {
+    using namespace task;
+    auto a = RandomVector<int>(size), b = RandomVector<int>(size);
+    Row("int32", "a | b", size, [&] {
+        auto result = a | b;
+        DoNotOptimize(result);
+    });
+    Row("int32", "a & b", size, [&] {
+        auto result = a & b;
+        DoNotOptimize(result);
+    });
+}
+
+
+int main() {
+    std::printf("ns per element\n");
+    std::printf("%-8s %-8s %10s %10s %10s %10s %9s\n", "type", "op", "size", "scalar", "sse2", "avx2",
+                "speedup");
+    for (std::size_t size : SIZES) {
+        Arithmetic<float>("float", size);
+        Arithmetic<double>("double", size);
+        Arithmetic<std::int32_t>("int32", size);
+        Arithmetic<std::int64_t>("int64", size);
+        Bitwise(size);
+    }
+}
@@ -0,0 +1,324 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector_ops.h"
+
+namespace task {
+
+// A batch of 3D vectors stored as structure of arrays: one contiguous
+// buffer per component, so that the batch operations below can work on
+// several vectors per instruction. Vector i is (x()[i], y()[i], z()[i]).
+template <class T>
+class VectorBatch3 {
+ public:
+  using value_type = T;
+
+  VectorBatch3() = default;
+
+  // count zero vectors.
+  explicit VectorBatch3(std::size_t count) : x_(count), y_(count), z_(count) {}
+
+  std::size_t size() const { return x_.size(); }
+
+  void resize(std::size_t count) {
+    x_.resize(count);
+    y_.resize(count);
+    z_.resize(count);
+  }
+
+  void reserve(std::size_t count) {
+    x_.reserve(count);
+    y_.reserve(count);
+    z_.reserve(count);
+  }
+
+  // vec has three elements.
+  void push_back(const std::vector<T>& vec) {
+    x_.push_back(vec[0]);
+    y_.push_back(vec[1]);
+    z_.push_back(vec[2]);
+  }
+
+  std::vector<T> get(std::size_t i) const { return {x_[i], y_[i], z_[i]}; }
+
+  void set(std::size_t i, const std::vector<T>& vec) {
+    x_[i] = vec[0];
+    y_[i] = vec[1];
+    z_[i] = vec[2];
+  }
+
+  T* x() { return x_.data(); }
+  T* y() { return y_.data(); }
+  T* z() { return z_.data(); }
+  const T* x() const { return x_.data(); }
+  const T* y() const { return y_.data(); }
+  const T* z() const { return z_.data(); }
+
+ private:
+  std::vector<T> x_;
+  std::vector<T> y_;
+  std::vector<T> z_;
+};
+
+namespace detail {
+
+// Component pointers of a batch, so that the kernels take six or nine
+// arguments instead of batches.
+template <class T>
+struct Components {
+  T* x;
+  T* y;
+  T* z;
+};
+
+template <class T>
+Components<const T> components(const VectorBatch3<T>& batch) {
+  return {batch.x(), batch.y(), batch.z()};
+}
+
+template <class T>
+Components<T> components(VectorBatch3<T>& batch) {
+  return {batch.x(), batch.y(), batch.z()};
+}
+
+// The batch kernels follow vector_simd.h: written once over GCC vector types
+// of BYTES bytes, with SSE2 and AVX2 entry points picked by simd_level().
+// Each vector register holds one component of several vectors of the batch.
+#define TASK_VECTOR_KERNEL inline __attribute__((always_inline))
+
+// Reads all inputs of an index before writing it, so out may be a or b.
+template <std::size_t BYTES, class T>
+TASK_VECTOR_KERNEL void cross_kernel(Components<const T> a, Components<const T> b, Components<T> out,
+                                     std::size_t n) {
+  typedef T V __attribute__((vector_size(BYTES)));
+  const std::size_t count = BYTES / sizeof(T);
+  std::size_t i = 0;
+  for (; i + count <= n; i += count) {
+    V ax, ay, az, bx, by, bz;
+    __builtin_memcpy(&ax, a.x + i, sizeof(V));
+    __builtin_memcpy(&ay, a.y + i, sizeof(V));
+    __builtin_memcpy(&az, a.z + i, sizeof(V));
+    __builtin_memcpy(&bx, b.x + i, sizeof(V));
+    __builtin_memcpy(&by, b.y + i, sizeof(V));
+    __builtin_memcpy(&bz, b.z + i, sizeof(V));
+    V x = ay * bz - az * by;
+    V y = az * bx - ax * bz;
+    V z = ax * by - ay * bx;
+    __builtin_memcpy(out.x + i, &x, sizeof(V));
+    __builtin_memcpy(out.y + i, &y, sizeof(V));
+    __builtin_memcpy(out.z + i, &z, sizeof(V));
+  }
+  for (; i < n; i++) {
+    T x = a.y[i] * b.z[i] - a.z[i] * b.y[i];
+    T y = a.z[i] * b.x[i] - a.x[i] * b.z[i];
+    T z = a.x[i] * b.y[i] - a.y[i] * b.x[i];
+    out.x[i] = x;
+    out.y[i] = y;
+    out.z[i] = z;
+  }
+}
+
+// out[i] = Acc(ax * bx) + Acc(ay * by) + Acc(az * bz): products in T and
+// sums in Acc, like dot<Acc> on a single vector.
+template <std::size_t BYTES, class Acc, class T>
+TASK_VECTOR_KERNEL void batch_dot_kernel(Components<const T> a, Components<const T> b, Acc* out,
+                                         std::size_t n) {
+  const std::size_t count = BYTES / sizeof(T);
+  typedef T V __attribute__((vector_size(BYTES)));
+  typedef Acc AccV __attribute__((vector_size(count * sizeof(Acc))));
+  std::size_t i = 0;
+  for (; i + count <= n; i += count) {
+    V ax, ay, az, bx, by, bz;
+    __builtin_memcpy(&ax, a.x + i, sizeof(V));
+    __builtin_memcpy(&ay, a.y + i, sizeof(V));
+    __builtin_memcpy(&az, a.z + i, sizeof(V));
+    __builtin_memcpy(&bx, b.x + i, sizeof(V));
+    __builtin_memcpy(&by, b.y + i, sizeof(V));
+    __builtin_memcpy(&bz, b.z + i, sizeof(V));
+    AccV result = __builtin_convertvector(ax * bx, AccV) + __builtin_convertvector(ay * by, AccV) +
+                  __builtin_convertvector(az * bz, AccV);
+    __builtin_memcpy(out + i, &result, sizeof(AccV));
+  }
+  for (; i < n; i++) {
+    out[i] = Acc(a.x[i] * b.x[i]) + Acc(a.y[i] * b.y[i]) + Acc(a.z[i] * b.z[i]);
+  }
+}
+
+template <class T>
+void cross_sse2(Components<const T> a, Components<const T> b, Components<T> out, std::size_t n) {
+  cross_kernel<16>(a, b, out, n);
+}
+
+template <class Acc, class T>
+void batch_dot_sse2(Components<const T> a, Components<const T> b, Acc* out, std::size_t n) {
+  batch_dot_kernel<16>(a, b, out, n);
+}
+
+#ifdef TASK_VECTOR_SIMD_X86
+
+template <class T>
+__attribute__((target("avx2"))) void cross_avx2(Components<const T> a, Components<const T> b, Components<T> out,
+                                                std::size_t n) {
+  cross_kernel<32>(a, b, out, n);
+}
+
+template <class Acc, class T>
+__attribute__((target("avx2"))) void batch_dot_avx2(Components<const T> a, Components<const T> b, Acc* out,
+                                                    std::size_t n) {
+  batch_dot_kernel<32>(a, b, out, n);
+}
+
+#endif
+
+#undef TASK_VECTOR_KERNEL
+
+// int64 stays scalar, it has neither a vector multiply nor a conversion to
+// double in these instruction sets.
+template <class T>
+struct HasBatchKernels
+    : std::integral_constant<bool, HasSimdKernels<T>::value && !std::is_same<T, std::int64_t>::value> {};
+
+template <class T>
+void cross(Components<const T> a, Components<const T> b, Components<T> out, std::size_t n) {
+  if constexpr (HasBatchKernels<T>::value) {
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2) {
+      cross_avx2(a, b, out, n);
+      return;
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar) {
+      cross_sse2(a, b, out, n);
+      return;
+    }
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    T x = a.y[i] * b.z[i] - a.z[i] * b.y[i];
+    T y = a.z[i] * b.x[i] - a.x[i] * b.z[i];
+    T z = a.x[i] * b.y[i] - a.y[i] * b.x[i];
+    out.x[i] = x;
+    out.y[i] = y;
+    out.z[i] = z;
+  }
+}
+
+template <class Acc, class T>
+void batch_dot(Components<const T> a, Components<const T> b, Acc* out, std::size_t n) {
+  if constexpr (HasBatchKernels<T>::value) {
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2) {
+      batch_dot_avx2<Acc>(a, b, out, n);
+      return;
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar) {
+      batch_dot_sse2<Acc>(a, b, out, n);
+      return;
+    }
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    out[i] = Acc(a.x[i] * b.x[i]) + Acc(a.y[i] * b.y[i]) + Acc(a.z[i] * b.z[i]);
+  }
+}
+
+// Applies decide(DotSums) to every pair of the batches. The three sums are
+// taken block by block into buffers on the stack, which stay in L1.
+template <class T, class Decide>
+void batch_check(const VectorBatch3<T>& a, const VectorBatch3<T>& b, std::uint8_t* out, const Decide& decide) {
+  const std::size_t BLOCK = 256;
+  double aa[BLOCK], bb[BLOCK], ab[BLOCK];
+  for (std::size_t begin = 0; begin < a.size(); begin += BLOCK) {
+    std::size_t n = a.size() - begin < BLOCK ? a.size() - begin : BLOCK;
+    Components<const T> x{a.x() + begin, a.y() + begin, a.z() + begin};
+    Components<const T> y{b.x() + begin, b.y() + begin, b.z() + begin};
+    batch_dot(x, x, aa, n);
+    batch_dot(y, y, bb, n);
+    batch_dot(x, y, ab, n);
+    for (std::size_t i = 0; i < n; i++) {
+      DotSums sums;
+      sums.aa = aa[i];
+      sums.bb = bb[i];
+      sums.ab = ab[i];
+      out[begin + i] = decide(sums);
+    }
+  }
+}
+
+}  // namespace detail
+
+// Batch forms of the vector_ops.h operators: element i of the result is the
+// operator applied to vector i of each batch, and the batches have the same
+// size. The output-parameter forms take a std::vector or, with C++20, a
+// std::span of a.size() elements, like add() and the others; checks write 1
+// for true and 0 for false.
+
+// out may be a or b.
+template <class T>
+void cross(VectorBatch3<T>& out, const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  out.resize(a.size());
+  detail::cross(detail::components(a), detail::components(b), detail::components(out), a.size());
+}
+
+template <class T>
+VectorBatch3<T> operator%(const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  VectorBatch3<T> result(a.size());
+  cross(result, a, b);
+  return result;
+}
+
+template <class Out, class T, detail::EnableIfOutput<Out, T> = 0>
+void dot(Out&& out, const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  detail::batch_dot(detail::components(a), detail::components(b), detail::output(out, a.size()), a.size());
+}
+
+template <class T>
+std::vector<T> dot(const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  std::vector<T> result;
+  dot(result, a, b);
+  return result;
+}
+
+template <class Out, class T, detail::EnableIfOutput<Out, double> = 0>
+void length2(Out&& out, const VectorBatch3<T>& a) {
+  detail::batch_dot(detail::components(a), detail::components(a), detail::output(out, a.size()), a.size());
+}
+
+template <class T>
+std::vector<double> length2(const VectorBatch3<T>& a) {
+  std::vector<double> result;
+  length2(result, a);
+  return result;
+}
+
+// a[i] || b[i].
+template <class Out, class T, detail::EnableIfOutput<Out, std::uint8_t> = 0>
+void parallel(Out&& out, const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  detail::batch_check(a, b, detail::output(out, a.size()), [](const detail::DotSums& sums) {
+    return detail::parallel(sums);
+  });
+}
+
+template <class T>
+std::vector<std::uint8_t> parallel(const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  std::vector<std::uint8_t> result;
+  parallel(result, a, b);
+  return result;
+}
+
+// a[i] && b[i].
+template <class Out, class T, detail::EnableIfOutput<Out, std::uint8_t> = 0>
+void codirectional(Out&& out, const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  detail::batch_check(a, b, detail::output(out, a.size()), [](const detail::DotSums& sums) {
+    return detail::parallel(sums) && sums.ab > 0;
+  });
+}
+
+template <class T>
+std::vector<std::uint8_t> codirectional(const VectorBatch3<T>& a, const VectorBatch3<T>& b) {
+  std::vector<std::uint8_t> result;
+  codirectional(result, a, b);
+  return result;
+}
+
+}  // namespace task
@@ -0,0 +1,190 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector_simd.h"
+
+namespace task {
+
+// A vector of bits packed 64 to a word, for masks that the std::vector<int>
+// operators | and & would store one int per element. The binary operators
+// work a word at a time through the vector kernels of vector_simd.h; as with
+// std::vector<int>, the result has the size of the left operand and the
+// right one must be at least as long.
+class BitVector {
+ public:
+  static const std::size_t WORD_BITS = 64;
+
+  BitVector() = default;
+
+  explicit BitVector(std::size_t size, bool value = false)
+      : words_(word_count(size), value ? ~std::uint64_t(0) : 0), size_(size) {
+    clear_tail();
+  }
+
+  // Element i is set when ints[i] is not zero.
+  explicit BitVector(const std::vector<int>& ints) : words_(word_count(ints.size())), size_(ints.size()) {
+    for (std::size_t w = 0; w < words_.size(); w++) {
+      std::size_t begin = w * WORD_BITS;
+      std::size_t end = std::min(begin + WORD_BITS, size_);
+      std::uint64_t word = 0;
+      for (std::size_t i = begin; i < end; i++) {
+        word |= std::uint64_t(ints[i] != 0) << (i - begin);
+      }
+      words_[w] = word;
+    }
+  }
+
+  // Ones and zeros.
+  explicit operator std::vector<int>() const {
+    std::vector<int> ints(size_);
+    for (std::size_t i = 0; i < size_; i++) {
+      ints[i] = int(words_[i / WORD_BITS] >> (i % WORD_BITS) & 1);
+    }
+    return ints;
+  }
+
+  std::size_t size() const { return size_; }
+
+  bool operator[](std::size_t i) const { return words_[i / WORD_BITS] >> (i % WORD_BITS) & 1; }
+
+  void set(std::size_t i, bool value) {
+    std::uint64_t bit = std::uint64_t(1) << (i % WORD_BITS);
+    words_[i / WORD_BITS] = value ? words_[i / WORD_BITS] | bit : words_[i / WORD_BITS] & ~bit;
+  }
+
+  // Number of set bits.
+  std::size_t count() const;
+
+  BitVector& operator|=(const BitVector& other) { return apply<detail::BinaryOp::Or>(other); }
+  BitVector& operator&=(const BitVector& other) { return apply<detail::BinaryOp::And>(other); }
+  BitVector& operator^=(const BitVector& other) { return apply<detail::BinaryOp::Xor>(other); }
+
+  friend void reverse(BitVector& bits);
+
+  // The words, bit i of the vector being bit i % 64 of word i / 64. Bits
+  // past size() in the last word are zero.
+  const std::uint64_t* data() const { return words_.data(); }
+
+  std::size_t words() const { return words_.size(); }
+
+ private:
+  static std::size_t word_count(std::size_t size) { return (size + WORD_BITS - 1) / WORD_BITS; }
+
+  // Bits past size_ are kept zero for count(), reverse() and comparisons.
+  void clear_tail() {
+    if (size_ % WORD_BITS != 0) {
+      words_.back() &= (std::uint64_t(1) << (size_ % WORD_BITS)) - 1;
+    }
+  }
+
+  // The kernels take the words as int64_t, which may alias uint64_t.
+  template <detail::BinaryOp OP>
+  BitVector& apply(const BitVector& other) {
+    auto words = reinterpret_cast<std::int64_t*>(words_.data());
+    detail::binary<OP>(words, reinterpret_cast<const std::int64_t*>(other.words_.data()), words, words_.size());
+    clear_tail();
+    return *this;
+  }
+
+  std::vector<std::uint64_t> words_;
+  std::size_t size_ = 0;
+};
+
+inline BitVector operator|(const BitVector& a, const BitVector& b) {
+  BitVector result(a);
+  return result |= b;
+}
+
+inline BitVector operator&(const BitVector& a, const BitVector& b) {
+  BitVector result(a);
+  return result &= b;
+}
+
+inline BitVector operator^(const BitVector& a, const BitVector& b) {
+  BitVector result(a);
+  return result ^= b;
+}
+
+inline bool operator==(const BitVector& a, const BitVector& b) {
+  return a.size() == b.size() && std::equal(a.data(), a.data() + a.words(), b.data());
+}
+
+inline bool operator!=(const BitVector& a, const BitVector& b) {
+  return !(a == b);
+}
+
+namespace detail {
+
+inline std::size_t popcount_portable(const std::uint64_t* words, std::size_t n) {
+  std::size_t result = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    result += __builtin_popcountll(words[i]);
+  }
+  return result;
+}
+
+#ifdef TASK_VECTOR_SIMD_X86
+
+// With the POPCNT instruction; four sums, as it has a latency of three
+// cycles and a throughput of one. Every CPU with AVX2 has POPCNT, so this
+// runs at the AVX2 level.
+__attribute__((target("popcnt"))) inline std::size_t popcount_popcnt(const std::uint64_t* words, std::size_t n) {
+  std::size_t sum[4] = {};
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (std::size_t u = 0; u < 4; u++) {
+      sum[u] += __builtin_popcountll(words[i + u]);
+    }
+  }
+  for (; i < n; i++) {
+    sum[0] += __builtin_popcountll(words[i]);
+  }
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#endif
+
+inline std::size_t popcount(const std::uint64_t* words, std::size_t n) {
+#ifdef TASK_VECTOR_SIMD_X86
+  if (simd_level() == SimdLevel::AVX2) {
+    return popcount_popcnt(words, n);
+  }
+#endif
+  return popcount_portable(words, n);
+}
+
+inline std::uint64_t reverse_bits(std::uint64_t word) {
+  word = __builtin_bswap64(word);
+  word = (word >> 4 & 0x0F0F0F0F0F0F0F0Full) | (word & 0x0F0F0F0F0F0F0F0Full) << 4;
+  word = (word >> 2 & 0x3333333333333333ull) | (word & 0x3333333333333333ull) << 2;
+  word = (word >> 1 & 0x5555555555555555ull) | (word & 0x5555555555555555ull) << 1;
+  return word;
+}
+
+}  // namespace detail
+
+inline std::size_t BitVector::count() const {
+  return detail::popcount(words_.data(), words_.size());
+}
+
+// Reverses the order of the words and of the bits in each of them, then
+// shifts the whole vector down past the unused bits of the last word.
+inline void reverse(BitVector& bits) {
+  std::vector<std::uint64_t>& words = bits.words_;
+  std::reverse(words.begin(), words.end());
+  for (std::uint64_t& word : words) {
+    word = detail::reverse_bits(word);
+  }
+  std::size_t shift = words.size() * BitVector::WORD_BITS - bits.size_;
+  if (shift == 0) {
+    return;
+  }
+  for (std::size_t w = 0; w + 1 < words.size(); w++) {
+    words[w] = words[w] >> shift | words[w + 1] << (BitVector::WORD_BITS - shift);
+  }
+  words.back() >>= shift;
+}
+
+}  // namespace task
@@ -0,0 +1,310 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __has_include(<span>)
+#include <span>
+#endif
+#include "vector_simd.h"
+
+namespace task {
+
+// Base of the lazy element-wise expressions over std::vector. The operators
+// +, - and unary - build a tree of these nodes instead of temporaries; the
+// tree is evaluated in one pass (and one allocation) when it is converted
+// to a std::vector, or with no allocation by assign(). element(i) is the
+// i-th element of the result.
+//
+// Leaves refer to their vectors and nodes are stored by value, so an
+// expression stays valid as long as the vectors it was built from; keeping
+// one in an auto variable past them is a dangling reference. A temporary
+// std::vector would not outlive the full expression, so +, - and unary -
+// with one evaluate right away, into its buffer, and return a std::vector.
+//
+// `auto x = a + b;` makes x an expression, not a std::vector: it
+// has size(), [] and the operators of vector_ops.h, but not the members of
+// std::vector such as push_back. Declare x as std::vector<T> (or apply
+// unary +) to get a vector.
+template <class E>
+class VectorExpr {
+ public:
+  const E& self() const { return static_cast<const E&>(*this); }
+
+  std::size_t size() const { return self().size(); }
+
+  auto operator[](std::size_t i) const { return self().element(i); }
+
+  template <class T, class U = E, class = std::enable_if_t<std::is_same<T, typename U::value_type>::value>>
+  operator std::vector<T>() const;
+};
+
+// Leaf: a std::vector taken by reference.
+template <class T>
+class VectorRef : public VectorExpr<VectorRef<T>> {
+ public:
+  using value_type = T;
+
+  explicit VectorRef(const std::vector<T>& data) : data_(data) {}
+
+  std::size_t size() const { return data_.size(); }
+
+  T element(std::size_t i) const { return data_[i]; }
+
+  const T* data() const { return data_.data(); }
+
+ private:
+  const std::vector<T>& data_;
+};
+
+// The size of a binary node is the size of its left operand, like the eager
+// operators it replaces.
+template <class L, class R>
+class VectorSum : public VectorExpr<VectorSum<L, R>> {
+ public:
+  using value_type = typename L::value_type;
+
+  VectorSum(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {}
+
+  std::size_t size() const { return lhs_.size(); }
+
+  value_type element(std::size_t i) const { return lhs_.element(i) + rhs_.element(i); }
+
+  const L& lhs() const { return lhs_; }
+
+  const R& rhs() const { return rhs_; }
+
+ private:
+  const L lhs_;
+  const R rhs_;
+};
+
+template <class L, class R>
+class VectorDifference : public VectorExpr<VectorDifference<L, R>> {
+ public:
+  using value_type = typename L::value_type;
+
+  VectorDifference(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {}
+
+  std::size_t size() const { return lhs_.size(); }
+
+  value_type element(std::size_t i) const { return lhs_.element(i) - rhs_.element(i); }
+
+  const L& lhs() const { return lhs_; }
+
+  const R& rhs() const { return rhs_; }
+
+ private:
+  const L lhs_;
+  const R rhs_;
+};
+
+template <class E>
+class VectorNegation : public VectorExpr<VectorNegation<E>> {
+ public:
+  using value_type = typename E::value_type;
+
+  explicit VectorNegation(const E& operand) : operand_(operand) {}
+
+  std::size_t size() const { return operand_.size(); }
+
+  value_type element(std::size_t i) const { return -operand_.element(i); }
+
+  const E& operand() const { return operand_; }
+
+ private:
+  const E operand_;
+};
+
+namespace detail {
+
+template <class T>
+VectorRef<T> as_expr(const std::vector<T>& data) {
+  return VectorRef<T>(data);
+}
+
+template <class E>
+const E& as_expr(const VectorExpr<E>& expr) {
+  return expr.self();
+}
+
+template <class X>
+using ExprOf = std::decay_t<decltype(as_expr(std::declval<const X&>()))>;
+
+template <class X>
+struct IsVectorOperand : std::is_base_of<VectorExpr<X>, X> {};
+
+template <class T>
+struct IsVectorOperand<std::vector<T>> : std::true_type {};
+
+// Both sides are vectors or expressions over the same element type.
+template <class L, class R, class = void>
+struct AreVectorOperands : std::false_type {};
+
+template <class L, class R>
+struct AreVectorOperands<L, R, std::enable_if_t<IsVectorOperand<L>::value && IsVectorOperand<R>::value>>
+    : std::is_same<typename ExprOf<L>::value_type, typename ExprOf<R>::value_type> {};
+
+// Vector operands of which at least one is an expression. The overloads of
+// the vector_ops.h operators for expressions take these, so that two
+// std::vector still pick the plain overloads.
+template <class L, class R>
+using EnableIfExpressionOperands =
+    std::enable_if_t<AreVectorOperands<L, R>::value &&
+                         (std::is_base_of<VectorExpr<L>, L>::value || std::is_base_of<VectorExpr<R>, R>::value),
+                     int>;
+
+// Evaluates expr into out[0, expr.size()). Single operations on vectors run
+// the vector kernels from vector_simd.h. Every node is element-wise, so out
+// may be one of the vectors in the expression.
+template <class E, class T>
+void evaluate(const E& expr, T* out) {
+  for (std::size_t i = 0; i < expr.size(); i++) {
+    out[i] = expr.element(i);
+  }
+}
+
+template <class T>
+void evaluate(const VectorSum<VectorRef<T>, VectorRef<T>>& expr, T* out) {
+  binary<BinaryOp::Add>(expr.lhs().data(), expr.rhs().data(), out, expr.size());
+}
+
+template <class T>
+void evaluate(const VectorDifference<VectorRef<T>, VectorRef<T>>& expr, T* out) {
+  binary<BinaryOp::Subtract>(expr.lhs().data(), expr.rhs().data(), out, expr.size());
+}
+
+template <class T>
+void evaluate(const VectorNegation<VectorRef<T>>& expr, T* out) {
+  negate(expr.operand().data(), out, expr.size());
+}
+
+// a[i] = a[i] OP b[i] over a.size() elements, for the compound assignments.
+template <BinaryOp OP, class T, class E>
+void update(std::vector<T>& a, const E& b) {
+  for (std::size_t i = 0; i < a.size(); i++) {
+    a[i] = apply<OP>(a[i], b.element(i));
+  }
+}
+
+template <BinaryOp OP, class T>
+void update(std::vector<T>& a, const VectorRef<T>& b) {
+  binary<OP>(a.data(), b.data(), a.data(), a.size());
+}
+
+}  // namespace detail
+
+template <class E>
+template <class T, class U, class>
+VectorExpr<E>::operator std::vector<T>() const {
+  std::vector<T> result(size());
+  detail::evaluate(self(), result.data());
+  return result;
+}
+
+// out = expr without allocating when out already has the right size.
+template <class T, class E>
+void assign(std::vector<T>& out, const VectorExpr<E>& expr) {
+  static_assert(std::is_same<T, typename E::value_type>::value, "element types differ");
+  if (out.size() != expr.size()) {
+    // Resizing could move a vector the expression refers to.
+    out = std::vector<T>(expr);
+    return;
+  }
+  detail::evaluate(expr.self(), out.data());
+}
+
+#ifdef __cpp_lib_span
+// out = expr into caller-provided storage of expr.size() elements.
+template <class T, class E>
+void assign(std::span<T> out, const VectorExpr<E>& expr) {
+  static_assert(std::is_same<T, typename E::value_type>::value, "element types differ");
+  detail::evaluate(expr.self(), out.data());
+}
+#endif
+
+template <class L, class R, std::enable_if_t<detail::AreVectorOperands<L, R>::value, int> = 0>
+VectorSum<detail::ExprOf<L>, detail::ExprOf<R>> operator+(const L& lhs, const R& rhs) {
+  return {detail::as_expr(lhs), detail::as_expr(rhs)};
+}
+
+template <class L, class R, std::enable_if_t<detail::AreVectorOperands<L, R>::value, int> = 0>
+VectorDifference<detail::ExprOf<L>, detail::ExprOf<R>> operator-(const L& lhs, const R& rhs) {
+  return {detail::as_expr(lhs), detail::as_expr(rhs)};
+}
+
+template <class T>
+VectorNegation<VectorRef<T>> operator-(const std::vector<T>& a) {
+  return VectorNegation<VectorRef<T>>(VectorRef<T>(a));
+}
+
+template <class E>
+VectorNegation<E> operator-(const VectorExpr<E>& a) {
+  return VectorNegation<E>(a.self());
+}
+
+template <class T, class R, std::enable_if_t<detail::AreVectorOperands<std::vector<T>, R>::value, int> = 0>
+std::vector<T> operator+(std::vector<T>&& lhs, const R& rhs) {
+  detail::update<detail::BinaryOp::Add>(lhs, detail::as_expr(rhs));
+  return std::move(lhs);
+}
+
+template <class L, class T, std::enable_if_t<detail::AreVectorOperands<L, std::vector<T>>::value, int> = 0>
+std::vector<T> operator+(const L& lhs, std::vector<T>&& rhs) {
+  assign(rhs, VectorSum<detail::ExprOf<L>, VectorRef<T>>(detail::as_expr(lhs), VectorRef<T>(rhs)));
+  return std::move(rhs);
+}
+
+template <class T>
+std::vector<T> operator+(std::vector<T>&& lhs, std::vector<T>&& rhs) {
+  detail::update<detail::BinaryOp::Add>(lhs, VectorRef<T>(rhs));
+  return std::move(lhs);
+}
+
+template <class T, class R, std::enable_if_t<detail::AreVectorOperands<std::vector<T>, R>::value, int> = 0>
+std::vector<T> operator-(std::vector<T>&& lhs, const R& rhs) {
+  detail::update<detail::BinaryOp::Subtract>(lhs, detail::as_expr(rhs));
+  return std::move(lhs);
+}
+
+template <class L, class T, std::enable_if_t<detail::AreVectorOperands<L, std::vector<T>>::value, int> = 0>
+std::vector<T> operator-(const L& lhs, std::vector<T>&& rhs) {
+  assign(rhs, VectorDifference<detail::ExprOf<L>, VectorRef<T>>(detail::as_expr(lhs), VectorRef<T>(rhs)));
+  return std::move(rhs);
+}
+
+template <class T>
+std::vector<T> operator-(std::vector<T>&& lhs, std::vector<T>&& rhs) {
+  detail::update<detail::BinaryOp::Subtract>(lhs, VectorRef<T>(rhs));
+  return std::move(lhs);
+}
+
+template <class T>
+std::vector<T> operator-(std::vector<T>&& a) {
+  detail::negate(a.data(), a.data(), a.size());
+  return std::move(a);
+}
+
+// Exact comparison, like == on std::vector, with an expression on either
+// side.
+template <class L, class R, detail::EnableIfExpressionOperands<L, R> = 0>
+bool operator==(const L& lhs, const R& rhs) {
+  const auto& a = detail::as_expr(lhs);
+  const auto& b = detail::as_expr(rhs);
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); i++) {
+    if (!(a.element(i) == b.element(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class L, class R, detail::EnableIfExpressionOperands<L, R> = 0>
+bool operator!=(const L& lhs, const R& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace task
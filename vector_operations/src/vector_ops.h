@@ -2,6 +2,9 @@
 #include <iostream>
 #include <utility>
 #include <vector>
+#include "vector_expr.h"
+#include "vector_reduce.h"
+#include "vector_simd.h"
 
 namespace task {
 
@@ -13,36 +16,117 @@ std::vector<T> operator+(const std::vector<T>& a) {
   return result;
 }
 
+// Evaluates the expression, so +(a + b) is a std::vector as before.
+template <class E>
+std::vector<typename E::value_type> operator+(const VectorExpr<E>& a) {
+  return a;
+}
+
+// Binary +, binary - and unary - are lazy, see vector_expr.h.
+
+// The compound assignments work in place and never allocate. The right-hand
+// side may be a vector or an expression, and may refer to a.
+template <class T, class X, std::enable_if_t<detail::AreVectorOperands<std::vector<T>, X>::value, int> = 0>
+std::vector<T>& operator+=(std::vector<T>& a, const X& b) {
+  detail::update<detail::BinaryOp::Add>(a, detail::as_expr(b));
+  return a;
+}
+
+template <class T, class X, std::enable_if_t<detail::AreVectorOperands<std::vector<T>, X>::value, int> = 0>
+std::vector<T>& operator-=(std::vector<T>& a, const X& b) {
+  detail::update<detail::BinaryOp::Subtract>(a, detail::as_expr(b));
+  return a;
+}
+
 template <class T>
-std::vector<T> operator-(const std::vector<T>& a) {
-  std::vector<T> result(a.size());
-  for (size_t i = 0; i < result.size(); i++) {
-    result[i] = -a[i];
-  }
-  return result;
+std::vector<T>& operator*=(std::vector<T>& a, const typename std::vector<T>::value_type& k) {
+  detail::scalar<detail::ScalarOp::Multiply>(a.data(), k, a.data(), a.size());
+  return a;
 }
 
 template <class T>
-std::vector<T> operator+(const std::vector<T>& a, const std::vector<T>& b) {
-  std::vector<T> result(a.size());
-  for (unsigned int i = 0; i < a.size(); i++) {
-    result[i] = a[i] + b[i];
-  }
-  return result;
+std::vector<T>& operator/=(std::vector<T>& a, const typename std::vector<T>::value_type& k) {
+  detail::scalar<detail::ScalarOp::Divide>(a.data(), k, a.data(), a.size());
+  return a;
+}
+
+namespace detail {
+
+// Where the output-parameter functions below write their n results. A vector
+// is resized, which does not allocate once it has the capacity; a span must
+// already hold n elements.
+template <class T>
+T* output(std::vector<T>& out, size_t n) {
+  out.resize(n);
+  return out.data();
 }
 
+#ifdef __cpp_lib_span
 template <class T>
-std::vector<T> operator-(const std::vector<T>& a, const std::vector<T>& b) {
-  return a + (-b);
+T* output(std::span<T> out, size_t) {
+  return out.data();
+}
+#endif
+
+template <class Out, class T>
+using EnableIfOutput = std::enable_if_t<std::is_same<decltype(output(std::declval<Out&>(), 0)), T*>::value, int>;
+
+}  // namespace detail
+
+// Output-parameter forms of the operators, for loops that reuse their
+// storage: out is a std::vector<T> or, with C++20, a std::span<T>. out may be
+// one of the operands.
+template <class Out, class T, detail::EnableIfOutput<Out, T> = 0>
+void add(Out&& out, const std::vector<T>& a, const std::vector<T>& b) {
+  detail::binary<detail::BinaryOp::Add>(a.data(), b.data(), detail::output(out, a.size()), a.size());
+}
+
+template <class Out, class T, detail::EnableIfOutput<Out, T> = 0>
+void subtract(Out&& out, const std::vector<T>& a, const std::vector<T>& b) {
+  detail::binary<detail::BinaryOp::Subtract>(a.data(), b.data(), detail::output(out, a.size()), a.size());
+}
+
+template <class Out, class T, detail::EnableIfOutput<Out, T> = 0>
+void negate(Out&& out, const std::vector<T>& a) {
+  detail::negate(a.data(), detail::output(out, a.size()), a.size());
+}
+
+template <class Out, class T, detail::EnableIfOutput<Out, T> = 0>
+void scale(Out&& out, const std::vector<T>& a, const typename std::vector<T>::value_type& k) {
+  detail::scalar<detail::ScalarOp::Multiply>(a.data(), k, detail::output(out, a.size()), a.size());
+}
+
+template <class Out, class T, detail::EnableIfOutput<Out, T> = 0>
+void cross(Out&& out, const std::vector<T>& a, const std::vector<T>& b) {
+  T x = a[1] * b[2] - a[2] * b[1];
+  T y = a[2] * b[0] - a[0] * b[2];
+  T z = a[0] * b[1] - a[1] * b[0];
+  T* result = detail::output(out, 3);
+  result[0] = x;
+  result[1] = y;
+  result[2] = z;
 }
 
 template <class T>
 T operator*(const std::vector<T>& a, const std::vector<T>& b) {
-  T result = 0;
-  for (unsigned int i = 0; i < a.size(); i++) {
-    result += a[i] * b[i];
-  }
-  return result;
+  return detail::reduce<T>(a.size(), [&](size_t begin, size_t end) {
+    return detail::dot<T>(a.data() + begin, b.data() + begin, end - begin);
+  });
+}
+
+// Dot product with an expression on either side, fused into one pass.
+template <class L, class R, detail::EnableIfExpressionOperands<L, R> = 0>
+typename detail::ExprOf<L>::value_type operator*(const L& lhs, const R& rhs) {
+  using T = typename detail::ExprOf<L>::value_type;
+  const auto& a = detail::as_expr(lhs);
+  const auto& b = detail::as_expr(rhs);
+  return detail::reduce<T>(a.size(), [&](size_t begin, size_t end) {
+    T result = 0;
+    for (size_t i = begin; i < end; i++) {
+      result += a.element(i) * b.element(i);
+    }
+    return result;
+  });
 }
 
 template <class T>
@@ -54,31 +138,94 @@ std::vector<T> operator%(const std::vector<T>& a, const std::vector<T>& b) {
   return result;
 }
 
+// Cross product with an expression on either side; only the three elements
+// it needs are evaluated.
+template <class L, class R, detail::EnableIfExpressionOperands<L, R> = 0>
+std::vector<typename detail::ExprOf<L>::value_type> operator%(const L& lhs, const R& rhs) {
+  const auto& a = detail::as_expr(lhs);
+  const auto& b = detail::as_expr(rhs);
+  std::vector<typename detail::ExprOf<L>::value_type> result(3);
+  result[0] = a.element(1) * b.element(2) - a.element(2) * b.element(1);
+  result[1] = a.element(2) * b.element(0) - a.element(0) * b.element(2);
+  result[2] = a.element(0) * b.element(1) - a.element(1) * b.element(0);
+  return result;
+}
+
 template <class T>
 double length2(const std::vector<T>& a) {
-  double result = 0;
-  for (const T& elem : a) {
-    result += elem * elem;
-  }
-  return result;
+  return detail::reduce<double>(a.size(), [&](size_t begin, size_t end) {
+    return detail::dot<double>(a.data() + begin, a.data() + begin, end - begin);
+  });
 }
 
+template <class E>
+double length2(const VectorExpr<E>& a) {
+  return detail::reduce<double>(a.size(), [&](size_t begin, size_t end) {
+    double result = 0;
+    for (size_t i = begin; i < end; i++) {
+      auto elem = a.self().element(i);
+      result += elem * elem;
+    }
+    return result;
+  });
+}
+
+namespace detail {
+
+// length2(a), length2(b) and a * b in a single pass.
 template <class T>
-bool operator||(const std::vector<T>& a, const std::vector<T>& b) {
-  double len2_a = length2(a);
-  double len2_b = length2(b);
-  if (len2_a != 0 && len2_b != 0) {
-    double dot = a * b;
-    double cos2fi = dot * dot / (len2_a * len2_b);
+DotSums dot_sums(const std::vector<T>& a, const std::vector<T>& b) {
+  return reduce<DotSums>(a.size(), [&](size_t begin, size_t end) {
+    return dot_sums(a.data() + begin, b.data() + begin, end - begin);
+  });
+}
+
+// The same with an expression on either side, fused into one pass.
+template <class L, class R>
+DotSums dot_sums(const VectorExpr<L>& a, const VectorExpr<R>& b) {
+  return reduce<DotSums>(a.size(), [&](size_t begin, size_t end) {
+    DotSums result;
+    for (size_t i = begin; i < end; i++) {
+      auto x = a.self().element(i);
+      auto y = b.self().element(i);
+      result.aa += double(x * x);
+      result.bb += double(y * y);
+      result.ab += double(x * y);
+    }
+    return result;
+  });
+}
+
+inline bool parallel(const DotSums& sums) {
+  if (sums.aa != 0 && sums.bb != 0) {
+    double cos2fi = sums.ab * sums.ab / (sums.aa * sums.bb);
     return 1 - cos2fi < ERR_EPS;
   }
   return true;
 }
 
+}  // namespace detail
+
+template <class T>
+bool operator||(const std::vector<T>& a, const std::vector<T>& b) {
+  return detail::parallel(detail::dot_sums(a, b));
+}
+
 template <class T>
 bool operator&&(const std::vector<T>& a, const std::vector<T>& b) {
-  double dot = a * b;
-  return (a || b) && (dot > 0);
+  detail::DotSums sums = detail::dot_sums(a, b);
+  return detail::parallel(sums) && sums.ab > 0;
+}
+
+template <class L, class R, detail::EnableIfExpressionOperands<L, R> = 0>
+bool operator||(const L& a, const R& b) {
+  return detail::parallel(detail::dot_sums(detail::as_expr(a), detail::as_expr(b)));
+}
+
+template <class L, class R, detail::EnableIfExpressionOperands<L, R> = 0>
+bool operator&&(const L& a, const R& b) {
+  detail::DotSums sums = detail::dot_sums(detail::as_expr(a), detail::as_expr(b));
+  return detail::parallel(sums) && sums.ab > 0;
 }
 
 template <class T>
@@ -103,6 +250,15 @@ std::ostream& operator<<(std::ostream& os, std::vector<T> data) {
   return os;
 }
 
+template <class E>
+std::ostream& operator<<(std::ostream& os, const VectorExpr<E>& data) {
+  for (size_t i = 0; i < data.size(); i++) {
+    os << data.self().element(i) << " ";
+  }
+  os << '\n';
+  return os;
+}
+
 template <class T>
 void reverse(std::vector<T>& data) {
   for (size_t i = 0; i < data.size() / 2; i++) {
@@ -113,18 +269,34 @@ void reverse(std::vector<T>& data) {
 std::vector<int> operator|(const std::vector<int>& a,
                            const std::vector<int>& b) {
   std::vector<int> result(a.size());
-  for (size_t i = 0; i < result.size(); i++) {
-    result[i] = a[i] | b[i];
-  }
+  detail::binary<detail::BinaryOp::Or>(a.data(), b.data(), result.data(), a.size());
   return result;
 }
 
 std::vector<int> operator&(const std::vector<int>& a,
                            const std::vector<int>& b) {
   std::vector<int> result(a.size());
-  for (size_t i = 0; i < result.size(); i++) {
-    result[i] = a[i] & b[i];
-  }
+  detail::binary<detail::BinaryOp::And>(a.data(), b.data(), result.data(), a.size());
   return result;
 }
+
+inline std::vector<int>& operator|=(std::vector<int>& a, const std::vector<int>& b) {
+  detail::binary<detail::BinaryOp::Or>(a.data(), b.data(), a.data(), a.size());
+  return a;
+}
+
+inline std::vector<int>& operator&=(std::vector<int>& a, const std::vector<int>& b) {
+  detail::binary<detail::BinaryOp::And>(a.data(), b.data(), a.data(), a.size());
+  return a;
+}
+
+template <class Out, detail::EnableIfOutput<Out, int> = 0>
+void bitwise_or(Out&& out, const std::vector<int>& a, const std::vector<int>& b) {
+  detail::binary<detail::BinaryOp::Or>(a.data(), b.data(), detail::output(out, a.size()), a.size());
+}
+
+template <class Out, detail::EnableIfOutput<Out, int> = 0>
+void bitwise_and(Out&& out, const std::vector<int>& a, const std::vector<int>& b) {
+  detail::binary<detail::BinaryOp::And>(a.data(), b.data(), detail::output(out, a.size()), a.size());
+}
 }  // namespace task
@@ -0,0 +1,215 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace task {
+
+// Threads used by the reductions in vector_ops.h (dot product, length2 and
+// the parallelism checks) on long vectors. 1, the default, keeps them on the
+// calling thread; 0 means one per hardware thread.
+//
+// The result does not depend on the thread count: a long vector is always
+// cut into the same chunks and their sums are combined in the same pairwise
+// tree, only the work on the chunks is shared between threads. The setting
+// may be changed while other threads compute; each reduction reads it once.
+namespace detail {
+
+inline std::atomic<unsigned>& current_reduction_threads() {
+  static std::atomic<unsigned> threads(1);
+  return threads;
+}
+
+}  // namespace detail
+
+inline unsigned reduction_threads() {
+  return detail::current_reduction_threads().load(std::memory_order_relaxed);
+}
+
+inline void set_reduction_threads(unsigned threads) {
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  detail::current_reduction_threads().store(threads > 0 ? threads : 1, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+// Vectors shorter than REDUCTION_MIN_SIZE are summed in one kernel call.
+// Longer ones are cut into chunks of REDUCTION_CHUNK elements, which keep
+// the kernels at full speed and are small enough to spread over threads.
+const std::size_t REDUCTION_CHUNK = std::size_t(1) << 14;
+const std::size_t REDUCTION_MIN_SIZE = std::size_t(1) << 18;
+
+// Worker threads kept from one reduction to the next. run(count, fn) calls
+// fn(0) ... fn(count - 1) on the workers and the calling thread and returns
+// when all calls are done; calls from several threads take turns. Workers
+// are started on demand, and if the system refuses more threads the indices
+// are shared by those that exist. If fn throws, the remaining indices are
+// skipped and run rethrows the first exception. fn is called through a plain
+// function pointer rather than a std::function, so run does not allocate.
+class ReductionWorkers {
+ public:
+  ReductionWorkers() = default;
+  ReductionWorkers(const ReductionWorkers&) = delete;
+  ReductionWorkers& operator=(const ReductionWorkers&) = delete;
+
+  ~ReductionWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  template <class Fn>
+  void run(std::size_t count, const Fn& fn) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    start(count - 1);
+    std::unique_lock<std::mutex> lock(mutex_);
+    fn_ = &fn;
+    invoke_ = [](const void* fn, std::size_t idx) { (*static_cast<const Fn*>(fn))(idx); };
+    count_ = count;
+    next_ = 0;
+    pending_ = count;
+    generation_++;
+    wake_.notify_all();
+    drain(lock);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    fn_ = nullptr;
+    if (error_) {
+      std::exception_ptr error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  void start(std::size_t threads) {
+    try {
+      while (workers_.size() < threads) {
+        workers_.emplace_back(&ReductionWorkers::work, this);
+      }
+    } catch (...) {
+      // Carry on with the workers that did start.
+    }
+  }
+
+  void work() {
+    std::size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      drain(lock);
+    }
+  }
+
+  void drain(std::unique_lock<std::mutex>& lock) {
+    while (fn_ != nullptr && next_ < count_) {
+      std::size_t idx = next_++;
+      const void* fn = fn_;
+      Invoke invoke = invoke_;
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        invoke(fn, idx);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      if (error) {
+        if (!error_) {
+          error_ = error;
+        }
+        pending_ -= count_ - next_;
+        next_ = count_;
+      }
+      if (--pending_ == 0) {
+        done_.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  using Invoke = void (*)(const void*, std::size_t);
+
+  const void* fn_ = nullptr;
+  Invoke invoke_ = nullptr;
+  std::size_t count_ = 0;
+  std::size_t next_ = 0;
+  std::size_t pending_ = 0;
+  std::size_t generation_ = 0;
+  std::exception_ptr error_;
+  bool stop_ = false;
+};
+
+inline ReductionWorkers& reduction_workers() {
+  static ReductionWorkers workers;
+  return workers;
+}
+
+// Room for the partial sums of chunks chunks. The buffer belongs to the
+// calling thread and only grows, so reductions stop allocating once it is
+// large enough.
+template <class R>
+R* partial_sums(std::size_t chunks) {
+  static thread_local std::vector<R> partial;
+  if (partial.size() < chunks) {
+    partial.resize(chunks);
+  }
+  return partial.data();
+}
+
+template <class R>
+R combine_pairwise(const R* partial, std::size_t count) {
+  if (count == 1) {
+    return partial[0];
+  }
+  std::size_t half = count / 2;
+  return combine_pairwise(partial, half) + combine_pairwise(partial + half, count - half);
+}
+
+// Sum of kernel(begin, end) over [0, n), where the kernel returns the sum of
+// its range as an R and R adds with +.
+template <class R, class Kernel>
+R reduce(std::size_t n, const Kernel& kernel) {
+  if (n < REDUCTION_MIN_SIZE) {
+    return kernel(0, n);
+  }
+  std::size_t chunks = (n + REDUCTION_CHUNK - 1) / REDUCTION_CHUNK;
+  R* partial = partial_sums<R>(chunks);
+  auto run = [&](std::size_t first, std::size_t last) {
+    for (std::size_t c = first; c < last; c++) {
+      std::size_t begin = c * REDUCTION_CHUNK;
+      partial[c] = kernel(begin, begin + REDUCTION_CHUNK < n ? begin + REDUCTION_CHUNK : n);
+    }
+  };
+  std::size_t threads = reduction_threads();
+  threads = threads < chunks ? threads : chunks;
+  if (threads == 1) {
+    run(0, chunks);
+  } else {
+    reduction_workers().run(threads, [&](std::size_t t) {
+      run(chunks * t / threads, chunks * (t + 1) / threads);
+    });
+  }
+  return combine_pairwise(partial, chunks);
+}
+
+}  // namespace detail
+}  // namespace task
@@ -0,0 +1,421 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_VECTOR_SIMD_X86
+#endif
+
+namespace task {
+
+// Instruction set used by the vector_ops.h kernels. The best level the CPU
+// supports is picked on first use; set_simd_level can lower it, which is how
+// the benchmark and the tests reach every code path. It may be changed while
+// other threads run kernels, which then use either level.
+enum class SimdLevel {
+  Scalar,
+  SSE2,
+  AVX2,
+};
+
+namespace detail {
+
+inline SimdLevel detect_simd_level() {
+#ifdef TASK_VECTOR_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SimdLevel::SSE2;
+  }
+#endif
+  return SimdLevel::Scalar;
+}
+
+inline std::atomic<SimdLevel>& current_simd_level() {
+  static std::atomic<SimdLevel> level(detect_simd_level());
+  return level;
+}
+
+}  // namespace detail
+
+inline SimdLevel max_simd_level() {
+  static const SimdLevel level = detail::detect_simd_level();
+  return level;
+}
+
+inline SimdLevel simd_level() {
+  return detail::current_simd_level().load(std::memory_order_relaxed);
+}
+
+inline void set_simd_level(SimdLevel level) {
+  detail::current_simd_level().store(level < max_simd_level() ? level : max_simd_level(),
+                                     std::memory_order_relaxed);
+}
+
+namespace detail {
+
+// Element types with vector kernels; everything else takes the scalar loops.
+template <class T>
+struct HasSimdKernels
+    : std::integral_constant<bool, std::is_same<T, float>::value || std::is_same<T, double>::value ||
+                                       std::is_same<T, std::int32_t>::value ||
+                                       std::is_same<T, std::int64_t>::value> {};
+
+enum class BinaryOp {
+  Add,
+  Subtract,
+  Or,
+  And,
+  Xor,
+};
+
+// a * a, b * b and a * b, the three sums behind the parallelism checks.
+struct DotSums {
+  double aa = 0;
+  double bb = 0;
+  double ab = 0;
+};
+
+inline DotSums operator+(const DotSums& x, const DotSums& y) {
+  return {x.aa + y.aa, x.bb + y.bb, x.ab + y.ab};
+}
+
+// Operations between a vector and a scalar.
+enum class ScalarOp {
+  Multiply,
+  Divide,
+};
+
+template <BinaryOp OP, class T>
+T apply(const T& x, const T& y) {
+  if constexpr (OP == BinaryOp::Add) {
+    return x + y;
+  } else if constexpr (OP == BinaryOp::Subtract) {
+    return x - y;
+  } else if constexpr (OP == BinaryOp::Or) {
+    return x | y;
+  } else if constexpr (OP == BinaryOp::And) {
+    return x & y;
+  } else {
+    return x ^ y;
+  }
+}
+
+// The kernels are written once over GCC vector types of BYTES bytes and
+// instantiated for 16 (SSE2) and 32 (AVX2) byte vectors; the AVX2 entry
+// points are compiled with target("avx2") and chosen at run time. Vector
+// values stay inside the kernel bodies (loads and stores are memcpy), so no
+// call passes them across targets.
+#define TASK_VECTOR_KERNEL inline __attribute__((always_inline))
+
+template <std::size_t BYTES, BinaryOp OP, class T>
+TASK_VECTOR_KERNEL void binary_kernel(const T* a, const T* b, T* out, std::size_t n) {
+  typedef T V __attribute__((vector_size(BYTES)));
+  const std::size_t count = BYTES / sizeof(T);
+  std::size_t i = 0;
+  for (; i + count <= n; i += count) {
+    V x, y, z;
+    __builtin_memcpy(&x, a + i, sizeof(V));
+    __builtin_memcpy(&y, b + i, sizeof(V));
+    if constexpr (OP == BinaryOp::Add) {
+      z = x + y;
+    } else if constexpr (OP == BinaryOp::Subtract) {
+      z = x - y;
+    } else if constexpr (OP == BinaryOp::Or) {
+      z = x | y;
+    } else if constexpr (OP == BinaryOp::And) {
+      z = x & y;
+    } else {
+      z = x ^ y;
+    }
+    __builtin_memcpy(out + i, &z, sizeof(V));
+  }
+  for (; i < n; i++) {
+    out[i] = apply<OP>(a[i], b[i]);
+  }
+}
+
+template <std::size_t BYTES, class T>
+TASK_VECTOR_KERNEL void negate_kernel(const T* a, T* out, std::size_t n) {
+  typedef T V __attribute__((vector_size(BYTES)));
+  const std::size_t count = BYTES / sizeof(T);
+  std::size_t i = 0;
+  for (; i + count <= n; i += count) {
+    V x;
+    __builtin_memcpy(&x, a + i, sizeof(V));
+    x = -x;
+    __builtin_memcpy(out + i, &x, sizeof(V));
+  }
+  for (; i < n; i++) {
+    out[i] = -a[i];
+  }
+}
+
+template <std::size_t BYTES, ScalarOp OP, class T>
+TASK_VECTOR_KERNEL void scalar_kernel(const T* a, T k, T* out, std::size_t n) {
+  typedef T V __attribute__((vector_size(BYTES)));
+  const std::size_t count = BYTES / sizeof(T);
+  std::size_t i = 0;
+  for (; i + count <= n; i += count) {
+    V x;
+    __builtin_memcpy(&x, a + i, sizeof(V));
+    if constexpr (OP == ScalarOp::Multiply) {
+      x = x * k;
+    } else {
+      x = x / k;
+    }
+    __builtin_memcpy(out + i, &x, sizeof(V));
+  }
+  for (; i < n; i++) {
+    out[i] = OP == ScalarOp::Multiply ? a[i] * k : a[i] / k;
+  }
+}
+
+// Sum of Acc(a[i] * b[i]) with four vector accumulators to hide the latency
+// of the additions. Products are taken in T, as in the scalar loop, and
+// converted to Acc before they are added.
+template <std::size_t BYTES, class Acc, class T>
+TASK_VECTOR_KERNEL Acc dot_kernel(const T* a, const T* b, std::size_t n) {
+  const std::size_t count = BYTES / sizeof(T);
+  typedef T V __attribute__((vector_size(BYTES)));
+  typedef Acc AccV __attribute__((vector_size(count * sizeof(Acc))));
+  AccV acc[4] = {};
+  std::size_t i = 0;
+  for (; i + 4 * count <= n; i += 4 * count) {
+    for (std::size_t u = 0; u < 4; u++) {
+      V x, y;
+      __builtin_memcpy(&x, a + i + u * count, sizeof(V));
+      __builtin_memcpy(&y, b + i + u * count, sizeof(V));
+      acc[u] += __builtin_convertvector(x * y, AccV);
+    }
+  }
+  for (; i + count <= n; i += count) {
+    V x, y;
+    __builtin_memcpy(&x, a + i, sizeof(V));
+    __builtin_memcpy(&y, b + i, sizeof(V));
+    acc[0] += __builtin_convertvector(x * y, AccV);
+  }
+  AccV total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+  Acc result = 0;
+  for (std::size_t l = 0; l < count; l++) {
+    result += total[l];
+  }
+  for (; i < n; i++) {
+    result += Acc(a[i] * b[i]);
+  }
+  return result;
+}
+
+// All three DotSums in one pass over a and b, two accumulators per sum.
+// Products are taken in T and summed as Acc; DotSums holds doubles.
+template <std::size_t BYTES, class Acc, class T>
+TASK_VECTOR_KERNEL DotSums dot_sums_kernel(const T* a, const T* b, std::size_t n) {
+  const std::size_t count = BYTES / sizeof(T);
+  typedef T V __attribute__((vector_size(BYTES)));
+  typedef Acc AccV __attribute__((vector_size(count * sizeof(Acc))));
+  AccV aa[2] = {}, bb[2] = {}, ab[2] = {};
+  std::size_t i = 0;
+  for (; i + 2 * count <= n; i += 2 * count) {
+    for (std::size_t u = 0; u < 2; u++) {
+      V x, y;
+      __builtin_memcpy(&x, a + i + u * count, sizeof(V));
+      __builtin_memcpy(&y, b + i + u * count, sizeof(V));
+      aa[u] += __builtin_convertvector(x * x, AccV);
+      bb[u] += __builtin_convertvector(y * y, AccV);
+      ab[u] += __builtin_convertvector(x * y, AccV);
+    }
+  }
+  for (; i + count <= n; i += count) {
+    V x, y;
+    __builtin_memcpy(&x, a + i, sizeof(V));
+    __builtin_memcpy(&y, b + i, sizeof(V));
+    aa[0] += __builtin_convertvector(x * x, AccV);
+    bb[0] += __builtin_convertvector(y * y, AccV);
+    ab[0] += __builtin_convertvector(x * y, AccV);
+  }
+  AccV total_aa = aa[0] + aa[1], total_bb = bb[0] + bb[1], total_ab = ab[0] + ab[1];
+  DotSums result;
+  for (std::size_t l = 0; l < count; l++) {
+    result.aa += total_aa[l];
+    result.bb += total_bb[l];
+    result.ab += total_ab[l];
+  }
+  for (; i < n; i++) {
+    result.aa += double(a[i] * a[i]);
+    result.bb += double(b[i] * b[i]);
+    result.ab += double(a[i] * b[i]);
+  }
+  return result;
+}
+
+template <BinaryOp OP, class T>
+void binary_sse2(const T* a, const T* b, T* out, std::size_t n) {
+  binary_kernel<16, OP>(a, b, out, n);
+}
+
+template <class T>
+void negate_sse2(const T* a, T* out, std::size_t n) {
+  negate_kernel<16>(a, out, n);
+}
+
+template <ScalarOp OP, class T>
+void scalar_sse2(const T* a, T k, T* out, std::size_t n) {
+  scalar_kernel<16, OP>(a, k, out, n);
+}
+
+template <class Acc, class T>
+Acc dot_sse2(const T* a, const T* b, std::size_t n) {
+  return dot_kernel<16, Acc>(a, b, n);
+}
+
+template <class T>
+DotSums dot_sums_sse2(const T* a, const T* b, std::size_t n) {
+  return dot_sums_kernel<16, double>(a, b, n);
+}
+
+#ifdef TASK_VECTOR_SIMD_X86
+
+template <BinaryOp OP, class T>
+__attribute__((target("avx2"))) void binary_avx2(const T* a, const T* b, T* out, std::size_t n) {
+  binary_kernel<32, OP>(a, b, out, n);
+}
+
+template <class T>
+__attribute__((target("avx2"))) void negate_avx2(const T* a, T* out, std::size_t n) {
+  negate_kernel<32>(a, out, n);
+}
+
+template <ScalarOp OP, class T>
+__attribute__((target("avx2"))) void scalar_avx2(const T* a, T k, T* out, std::size_t n) {
+  scalar_kernel<32, OP>(a, k, out, n);
+}
+
+template <class Acc, class T>
+__attribute__((target("avx2"))) Acc dot_avx2(const T* a, const T* b, std::size_t n) {
+  return dot_kernel<32, Acc>(a, b, n);
+}
+
+template <class T>
+__attribute__((target("avx2"))) DotSums dot_sums_avx2(const T* a, const T* b, std::size_t n) {
+  return dot_sums_kernel<32, double>(a, b, n);
+}
+
+#endif
+
+#undef TASK_VECTOR_KERNEL
+
+// Dispatchers. Types without vector kernels and the Scalar level run the
+// plain loops.
+template <BinaryOp OP, class T>
+void binary(const T* a, const T* b, T* out, std::size_t n) {
+  if constexpr (HasSimdKernels<T>::value) {
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2) {
+      binary_avx2<OP>(a, b, out, n);
+      return;
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar) {
+      binary_sse2<OP>(a, b, out, n);
+      return;
+    }
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    out[i] = apply<OP>(a[i], b[i]);
+  }
+}
+
+template <class T>
+void negate(const T* a, T* out, std::size_t n) {
+  if constexpr (HasSimdKernels<T>::value) {
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2) {
+      negate_avx2(a, out, n);
+      return;
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar) {
+      negate_sse2(a, out, n);
+      return;
+    }
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    out[i] = -a[i];
+  }
+}
+
+// out[i] = a[i] * k or a[i] / k. Only floating point types and the int32
+// product take the vector kernels: there is no integer division in either
+// instruction set, nor a 64-bit integer multiply.
+template <ScalarOp OP, class T>
+void scalar(const T* a, T k, T* out, std::size_t n) {
+  if constexpr (std::is_floating_point<T>::value ||
+                (std::is_same<T, std::int32_t>::value && OP == ScalarOp::Multiply)) {
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2) {
+      scalar_avx2<OP>(a, k, out, n);
+      return;
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar) {
+      scalar_sse2<OP>(a, k, out, n);
+      return;
+    }
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    out[i] = OP == ScalarOp::Multiply ? a[i] * k : a[i] / k;
+  }
+}
+
+// Sum of Acc(a[i] * b[i]). Neither SSE2 nor AVX2 has a 64-bit integer
+// multiply or an int64 to double conversion; the emulated ones lose to the
+// scalar loop, so int64 only takes the AVX2 kernel, and only for int64 sums.
+template <class Acc, class T>
+Acc dot(const T* a, const T* b, std::size_t n) {
+  if constexpr (HasSimdKernels<T>::value) {
+    const bool int64 = std::is_same<T, std::int64_t>::value;
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2 && (!int64 || std::is_same<Acc, T>::value)) {
+      return dot_avx2<Acc>(a, b, n);
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar && !int64) {
+      return dot_sse2<Acc>(a, b, n);
+    }
+  }
+  Acc result = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    result += Acc(a[i] * b[i]);
+  }
+  return result;
+}
+
+// int64 has no vector kernel here: its sums are doubles, see dot.
+template <class T>
+DotSums dot_sums(const T* a, const T* b, std::size_t n) {
+  if constexpr (HasSimdKernels<T>::value && !std::is_same<T, std::int64_t>::value) {
+#ifdef TASK_VECTOR_SIMD_X86
+    if (simd_level() == SimdLevel::AVX2) {
+      return dot_sums_avx2(a, b, n);
+    }
+#endif
+    if (simd_level() != SimdLevel::Scalar) {
+      return dot_sums_sse2(a, b, n);
+    }
+  }
+  DotSums result;
+  for (std::size_t i = 0; i < n; i++) {
+    result.aa += double(a[i] * a[i]);
+    result.bb += double(b[i] * b[i]);
+    result.ab += double(a[i] * b[i]);
+  }
+  return result;
+}
+
+}  // namespace detail
+}  // namespace task
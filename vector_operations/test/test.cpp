@@ -6,12 +6,51 @@
 #include <valarray>
 #include <sstream>
 #include <cmath>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <thread>
 #include "src/vector_ops.h"
+#include "src/vector_batch.h"
+#include "src/vector_bits.h"
 
 
 using namespace task;
 
 
+// Atomic, as the reduction workers and the threads of the concurrency tests
+// allocate too.
+std::atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+
 size_t RandomUInt(size_t max = -1) {
     static std::mt19937 rand(std::random_device{}());
 
@@ -235,4 +274,415 @@ int main() {
         ASSERT_EQUAL_MSG(vec, vec2, "reverse")
     }
 
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        set_simd_level(level);
+        REPEAT(20)
+        {
+            // Odd lengths leave a tail after the vector loops.
+            size_t size = RandomUInt(0, 300);
+            std::vector<double> vec, vec2;
+            RandomFillDouble(vec, size);
+            RandomFillDouble(vec2, size);
+            std::vector<float> fvec(vec.begin(), vec.end()), fvec2(vec2.begin(), vec2.end());
+            std::vector<int64_t> lvec, lvec2;
+            RandomFill(lvec, size, 1000);
+            RandomFill(lvec2, size, 1000);
+            std::vector<int> ivec(lvec.begin(), lvec.end()), ivec2(lvec2.begin(), lvec2.end());
+            std::vector<short> svec(lvec.begin(), lvec.end()), svec2(lvec2.begin(), lvec2.end());
+
+            std::vector<double> sum = vec + vec2, difference = vec - vec2, negated = -vec;
+            std::vector<float> fsum = fvec + fvec2, fdifference = fvec - fvec2;
+            std::vector<int64_t> lsum = lvec + lvec2, ldifference = lvec - lvec2;
+            std::vector<int> isum = ivec + ivec2, ior = ivec | ivec2, iand = ivec & ivec2;
+            std::vector<short> ssum = svec + svec2;
+            std::vector<double> scaled = vec;
+            scaled *= 3.;
+            std::vector<float> fquotient = fvec;
+            fquotient /= 7.f;
+            std::vector<int> iscaled = ivec;
+            iscaled *= -3;
+            std::vector<int64_t> lquotient = lvec;
+            lquotient /= 7;
+            double dot = 0, fdot = 0, length = 0;
+            int64_t ldot = 0, idot = 0;
+            for (size_t i = 0; i < size; ++i) {
+                ASSERT_TRUE_MSG(sum[i] == vec[i] + vec2[i] && fsum[i] == fvec[i] + fvec2[i] &&
+                                lsum[i] == lvec[i] + lvec2[i] && isum[i] == ivec[i] + ivec2[i] &&
+                                ssum[i] == short(svec[i] + svec2[i]), "SIMD binary +")
+                ASSERT_TRUE_MSG(difference[i] == vec[i] - vec2[i] && fdifference[i] == fvec[i] - fvec2[i] &&
+                                ldifference[i] == lvec[i] - lvec2[i], "SIMD binary -")
+                ASSERT_TRUE_MSG(negated[i] == -vec[i], "SIMD unary -")
+                ASSERT_TRUE_MSG(scaled[i] == vec[i] * 3. && fquotient[i] == fvec[i] / 7.f &&
+                                iscaled[i] == ivec[i] * -3 && lquotient[i] == lvec[i] / 7, "SIMD scaling")
+                ASSERT_TRUE_MSG(ior[i] == (ivec[i] | ivec2[i]) && iand[i] == (ivec[i] & ivec2[i]),
+                                "SIMD bitwise operators")
+                dot += vec[i] * vec2[i];
+                fdot += fvec[i] * fvec2[i];
+                length += vec[i] * vec[i];
+                ldot += lvec[i] * lvec2[i];
+                idot += ivec[i] * ivec2[i];
+            }
+            ASSERT_TRUE_MSG(fabs(vec * vec2 - dot) < EPS && fabs(fvec * fvec2 - fdot) < 1e-1, "SIMD dot product")
+            ASSERT_TRUE_MSG(lvec * lvec2 == ldot && ivec * ivec2 == idot, "SIMD integer dot product")
+            ASSERT_TRUE_MSG(fabs(length2(vec) - length) < EPS, "SIMD length2")
+            std::vector<float> fscaled = fvec;
+            fscaled *= -2.f;
+            // Empty vectors are parallel but not codirectional.
+            ASSERT_TRUE_MSG((vec || scaled) && (size == 0 || (vec && scaled)) && (fvec || fscaled) &&
+                            !(fvec && fscaled) && (ivec || iscaled) && !(ivec && iscaled), "SIMD parallelism checks")
+        }
+    }
+    set_simd_level(max_simd_level());
+
+    REPEAT(100)
+    {
+        size_t size = RandomUInt(0, 300);
+        std::vector<double> vec, vec2, vec3;
+        RandomFillDouble(vec, size);
+        RandomFillDouble(vec2, size);
+        RandomFillDouble(vec3, size);
+
+        size_t before = allocation_count;
+        std::vector<double> chain = vec + vec2 - vec3;
+        ASSERT_TRUE_MSG(allocation_count - before == (size > 0 ? 1 : 0), "Expression allocations")
+        std::vector<double> negated = -(vec - vec2) + -vec3;
+
+        std::vector<double> out(size);
+        before = allocation_count;
+        assign(out, vec - (vec2 + vec3));
+        ASSERT_TRUE_MSG(allocation_count == before, "assign() allocations")
+
+        double dot = 0, length = 0;
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_TRUE_MSG(fabs(chain[i] - (vec[i] + vec2[i] - vec3[i])) < EPS, "Expression a + b - c")
+            ASSERT_TRUE_MSG(fabs(negated[i] - (vec2[i] - vec[i] - vec3[i])) < EPS, "Expression negation")
+            ASSERT_TRUE_MSG(fabs(out[i] - (vec[i] - (vec2[i] + vec3[i]))) < EPS, "assign()")
+            dot += (vec[i] + vec2[i]) * vec3[i];
+            length += (vec[i] - vec2[i]) * (vec[i] - vec2[i]);
+        }
+        ASSERT_TRUE_MSG(fabs((vec + vec2) * vec3 - dot) < EPS, "Expression dot product")
+        ASSERT_TRUE_MSG(fabs(length2(vec - vec2) - length) < EPS, "Expression length2")
+
+        // The other operators take expressions as well.
+        std::vector<double> sum = vec + vec2, difference = vec - vec2;
+        std::ostringstream printed, expected_printed;
+        printed << vec + vec2;
+        expected_printed << sum;
+        ASSERT_TRUE_MSG(printed.str() == expected_printed.str(), "Expression output")
+        static_assert(std::is_same<decltype(+(vec + vec2)), std::vector<double>>::value, "Expression unary +");
+        std::vector<double> plus = +(vec + vec2);
+        ASSERT_EQUAL_MSG(plus, sum, "Expression unary +")
+        plus.push_back(1.);
+        ASSERT_TRUE_MSG(plus.size() == size + 1, "Evaluated expression is a vector")
+        ASSERT_TRUE_MSG(((vec - vec2) || vec3) == (difference || vec3) &&
+                        ((vec - vec2) && vec3) == (difference && vec3), "Expression parallelism checks")
+        ASSERT_TRUE_MSG(((vec - vec2) || difference) && ((vec - vec2) || -(vec - vec2)) &&
+                        !((vec - vec2) && -(vec - vec2)), "Expression parallelism checks")
+        if (size >= 3) {
+            std::vector<double> cross = (vec + vec2) % vec3, cross2 = vec3 % (vec + vec2);
+            std::vector<double> expected_cross = sum % vec3;
+            for (size_t i = 0; i < 3; ++i) {
+                ASSERT_TRUE_MSG(fabs(cross[i] - expected_cross[i]) < EPS &&
+                                fabs(cross2[i] + expected_cross[i]) < EPS, "Expression cross product")
+            }
+        }
+        ASSERT_TRUE_MSG((vec + vec2) == sum && sum == vec + vec2 && !((vec + vec2) != sum) &&
+                        (vec - vec2) == difference && (size == 0 || (vec + vec2) != difference + vec3),
+                        "Expression comparisons")
+
+        // A temporary vector is evaluated into right away instead of being
+        // referred to, so keeping the result in an auto variable is safe.
+        auto copy = [&] { return vec3; };
+        static_assert(std::is_same<decltype(copy() + vec), std::vector<double>>::value, "Temporary operand");
+        before = allocation_count;
+        auto left_sum = copy() + vec;
+        ASSERT_TRUE_MSG(allocation_count - before == (size > 0 ? 1 : 0), "Temporary operand allocations")
+        auto right_sum = vec + copy();
+        auto both_sum = copy() + copy();
+        auto left_difference = copy() - (vec + vec2);
+        auto right_difference = vec - copy();
+        auto both_difference = copy() - copy();
+        auto negated_copy = -copy();
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_TRUE_MSG(left_sum[i] == vec3[i] + vec[i] && right_sum[i] == vec[i] + vec3[i] &&
+                            both_sum[i] == vec3[i] + vec3[i], "Temporary operand +")
+            ASSERT_TRUE_MSG(left_difference[i] == vec3[i] - (vec[i] + vec2[i]) &&
+                            right_difference[i] == vec[i] - vec3[i] && both_difference[i] == 0. &&
+                            negated_copy[i] == -vec3[i], "Temporary operand -")
+        }
+
+        // Assigning into an operand, with and without a size change.
+        std::vector<double> expected = vec2 - vec + vec3;
+        assign(vec, vec2 - vec + vec3);
+        ASSERT_EQUAL_MSG(vec, expected, "assign() into an operand")
+        std::vector<double> shorter(size / 2);
+        assign(shorter, vec2 - vec3 + vec);
+        ASSERT_TRUE_MSG(shorter.size() == size, "assign() resizes")
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_TRUE_MSG(fabs(shorter[i] - (vec2[i] - vec3[i] + vec[i])) < EPS, "assign() resizes")
+        }
+    }
+
+
+    REPEAT(100)
+    {
+        size_t size = RandomUInt(0, 300);
+        std::vector<double> vec, vec2;
+        RandomFillDouble(vec, size);
+        RandomFillDouble(vec2, size);
+        std::vector<int> ivec, ivec2;
+        RandomFill(ivec, size, 1000);
+        RandomFill(ivec2, size, 1000);
+        std::vector<double> cross_a, cross_b;
+        RandomFillDouble(cross_a, 3);
+        RandomFillDouble(cross_b, 3);
+
+        std::vector<double> acc = vec, aliased, sum, difference, negated, scaled, product;
+        std::vector<int> ior, iand, imask;
+        // The first round sizes the outputs, every later one reuses them.
+        size_t before = allocation_count;
+        for (size_t round = 0; round < 4; ++round) {
+            if (round == 1) {
+                before = allocation_count;
+            }
+            acc += vec2;
+            acc -= vec2 - vec;
+            acc *= 4.;
+            acc /= 4.;
+            aliased = vec;
+            aliased += aliased - vec2;
+            add(sum, vec, vec2);
+            subtract(difference, vec, vec2);
+            negate(negated, vec);
+            scale(scaled, vec, 0.5);
+            cross(product, cross_a, cross_b);
+            imask = ivec;
+            imask |= ivec2;
+            imask &= ivec;
+            bitwise_or(ior, ivec, ivec2);
+            bitwise_and(iand, ivec, ivec2);
+        }
+        ASSERT_TRUE_MSG(allocation_count == before, "Steady-state allocations")
+
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_TRUE_MSG(fabs(acc[i] - 5 * vec[i]) < EPS, "Compound assignment")
+            ASSERT_TRUE_MSG(fabs(aliased[i] - (2 * vec[i] - vec2[i])) < EPS, "Compound assignment into an operand")
+            ASSERT_TRUE_MSG(sum[i] == vec[i] + vec2[i] && difference[i] == vec[i] - vec2[i], "add() and subtract()")
+            ASSERT_TRUE_MSG(negated[i] == -vec[i] && scaled[i] == vec[i] * 0.5, "negate() and scale()")
+            ASSERT_TRUE_MSG(ior[i] == (ivec[i] | ivec2[i]) && iand[i] == (ivec[i] & ivec2[i]) &&
+                            imask[i] == ivec[i], "Bitwise output parameters")
+        }
+        std::vector<double> expected = cross_a % cross_b;
+        ASSERT_EQUAL_MSG(product, expected, "cross()")
+
+        // Output parameters that are also operands.
+        cross(cross_a, cross_a, cross_b);
+        ASSERT_EQUAL_MSG(cross_a, expected, "cross() into an operand")
+        expected = vec + vec2;
+        add(vec, vec, vec2);
+        ASSERT_EQUAL_MSG(vec, expected, "add() into an operand")
+    }
+
+    REPEAT(3)
+    {
+        // Long enough to be split into chunks; the sums must not depend on
+        // the number of threads.
+        size_t size = RandomUInt(300000, 700000);
+        std::vector<double> vec, vec2;
+        RandomFillDouble(vec, size);
+        RandomFillDouble(vec2, size);
+        std::vector<double> parallel = vec, opposite = vec;
+        parallel *= 3.;
+        opposite *= -0.5;
+        opposite[RandomUInt(size - 1)] += 100.;
+
+        double dot = 0, length = 0;
+        for (size_t i = 0; i < size; ++i) {
+            dot += vec[i] * vec2[i];
+            length += vec[i] * vec[i];
+        }
+
+        double threaded_dot = 0, threaded_length = 0, expression_dot = 0;
+        for (unsigned threads : {1u, 2u, 3u, 0u}) {
+            set_reduction_threads(threads);
+            if (threads == 1) {
+                threaded_dot = vec * vec2;
+                threaded_length = length2(vec);
+                expression_dot = (vec - vec2) * vec2;
+            }
+            ASSERT_TRUE_MSG(vec * vec2 == threaded_dot && length2(vec) == threaded_length &&
+                            (vec - vec2) * vec2 == expression_dot, "Reductions depend on the thread count")
+            ASSERT_TRUE_MSG((vec || parallel) && (vec && parallel), "Threaded parallelism checks")
+            ASSERT_TRUE_MSG(!(vec || opposite) && !(vec && opposite), "Threaded parallelism checks")
+        }
+
+        // The workers and the buffer of partial sums are kept between
+        // reductions, and reductions from several threads may run at the same
+        // time as the setting changes.
+        set_reduction_threads(3);
+        vec * vec2;
+        size_t before = allocation_count;
+        ASSERT_TRUE_MSG(vec * vec2 == threaded_dot && length2(vec) == threaded_length && (vec || parallel),
+                        "Reused reduction workers")
+        ASSERT_TRUE_MSG(allocation_count == before, "Reductions do not allocate")
+        set_reduction_threads(1);
+        before = allocation_count;
+        ASSERT_TRUE_MSG(vec * vec2 == threaded_dot, "Reductions do not allocate")
+        ASSERT_TRUE_MSG(allocation_count == before, "Reductions do not allocate")
+        std::atomic<bool> concurrent_ok(true);
+        auto reductions = [&] {
+            for (int i = 0; i < 4; ++i) {
+                if (vec * vec2 != threaded_dot || !(vec || parallel)) {
+                    concurrent_ok = false;
+                }
+            }
+        };
+        std::thread first(reductions), second(reductions);
+        std::thread setter([] {
+            for (unsigned threads : {2u, 1u, 4u, 3u}) {
+                set_reduction_threads(threads);
+                std::this_thread::yield();
+            }
+        });
+        first.join();
+        second.join();
+        setter.join();
+        ASSERT_TRUE_MSG(concurrent_ok, "Concurrent reductions")
+
+        set_reduction_threads(1);
+        ASSERT_TRUE_MSG(fabs(threaded_dot - dot) < 1e-6 * size && fabs(threaded_length - length) < 1e-6 * size,
+                        "Threaded reductions")
+    }
+
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        set_simd_level(level);
+        REPEAT(20)
+        {
+            size_t size = RandomUInt(0, 300);
+            VectorBatch3<double> batch, batch2;
+            VectorBatch3<float> fbatch, fbatch2;
+            VectorBatch3<int> ibatch, ibatch2;
+            std::vector<std::vector<double>> vecs, vecs2;
+            for (size_t i = 0; i < size; ++i) {
+                std::vector<double> vec, vec2;
+                RandomFillDouble(vec, 3);
+                // Every third pair is parallel or opposite.
+                if (i % 3 == 0) {
+                    vec2 = vec;
+                    vec2 *= RandomDouble();
+                } else {
+                    RandomFillDouble(vec2, 3);
+                }
+                vecs.push_back(vec);
+                vecs2.push_back(vec2);
+                batch.push_back(vec);
+                batch2.push_back(vec2);
+                fbatch.push_back(std::vector<float>(vec.begin(), vec.end()));
+                fbatch2.push_back(std::vector<float>(vec2.begin(), vec2.end()));
+                ibatch.push_back(std::vector<int>(vec.begin(), vec.end()));
+                ibatch2.push_back(std::vector<int>(vec2.begin(), vec2.end()));
+            }
+
+            VectorBatch3<double> cross = batch % batch2;
+            VectorBatch3<float> fcross = fbatch % fbatch2;
+            VectorBatch3<int> icross = ibatch % ibatch2;
+            std::vector<double> dot = task::dot(batch, batch2), length = length2(batch);
+            std::vector<float> fdot = task::dot(fbatch, fbatch2);
+            std::vector<double> flength = length2(fbatch);
+            std::vector<int> idot = task::dot(ibatch, ibatch2);
+            std::vector<uint8_t> parallel = task::parallel(batch, batch2);
+            std::vector<uint8_t> codirectional = task::codirectional(batch, batch2);
+            std::vector<uint8_t> iparallel = task::parallel(ibatch, ibatch2);
+            for (size_t i = 0; i < size; ++i) {
+                std::vector<float> fvec = fbatch.get(i), fvec2 = fbatch2.get(i);
+                std::vector<int> ivec = ibatch.get(i), ivec2 = ibatch2.get(i);
+                ASSERT_TRUE_MSG(cross.get(i) == vecs[i] % vecs2[i] && fcross.get(i) == fvec % fvec2 &&
+                                icross.get(i) == ivec % ivec2, "Batch cross product")
+                ASSERT_TRUE_MSG(fabs(dot[i] - vecs[i] * vecs2[i]) < EPS && fabs(fdot[i] - fvec * fvec2) < 1e-3 &&
+                                idot[i] == ivec * ivec2, "Batch dot product")
+                ASSERT_TRUE_MSG(fabs(length[i] - length2(vecs[i])) < EPS && fabs(flength[i] - length2(fvec)) < EPS,
+                                "Batch length2")
+                ASSERT_TRUE_MSG(parallel[i] == (vecs[i] || vecs2[i]) && iparallel[i] == (ivec || ivec2),
+                                "Batch parallelism check")
+                ASSERT_TRUE_MSG(codirectional[i] == (vecs[i] && vecs2[i]), "Batch codirectionality check")
+            }
+
+            // Output parameters, with the result written over an operand.
+            size_t before = allocation_count;
+            task::dot(dot, batch2, batch);
+            task::parallel(parallel, batch2, batch);
+            task::cross(batch, batch, batch2);
+            ASSERT_TRUE_MSG(allocation_count == before, "Batch output parameter allocations")
+            for (size_t i = 0; i < size; ++i) {
+                ASSERT_TRUE_MSG(batch.get(i) == cross.get(i), "Batch cross product into an operand")
+            }
+        }
+    }
+    set_simd_level(max_simd_level());
+
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        set_simd_level(level);
+        REPEAT(20)
+        {
+            size_t size = RandomUInt(0, 700);
+            std::vector<int> ivec, ivec2;
+            RandomFill(ivec, size, 1);
+            RandomFill(ivec2, size, 1);
+            BitVector bits(ivec), bits2(ivec2);
+            ASSERT_TRUE_MSG(bits.size() == size && std::vector<int>(bits) == ivec, "BitVector conversions")
+
+            BitVector ored = bits | bits2, anded = bits & bits2, xored = bits ^ bits2;
+            std::vector<int> ior = ivec | ivec2, iand = ivec & ivec2;
+            size_t count = 0;
+            for (size_t i = 0; i < size; ++i) {
+                ASSERT_TRUE_MSG(ored[i] == bool(ior[i]) && anded[i] == bool(iand[i]) &&
+                                xored[i] == (ivec[i] != ivec2[i]), "BitVector binary operators")
+                count += ivec[i];
+            }
+            ASSERT_TRUE_MSG(bits.count() == count && BitVector(size, true).count() == size, "BitVector count")
+
+            std::vector<int> reversed = ivec;
+            reverse(reversed);
+            BitVector reversed_bits = bits;
+            reverse(reversed_bits);
+            ASSERT_TRUE_MSG(reversed_bits == BitVector(reversed), "BitVector reverse")
+
+            size_t before = allocation_count;
+            bits ^= bits2;
+            bits |= bits2;
+            bits &= ored;
+            ASSERT_TRUE_MSG(allocation_count == before, "BitVector compound assignment allocations")
+            ASSERT_TRUE_MSG(bits == ored, "BitVector compound assignment")
+            if (size > 0) {
+                size_t index = RandomUInt(size - 1);
+                bits.set(index, !bits[index]);
+                ASSERT_TRUE_MSG(bits != ored && bits.count() == ored.count() + (ored[index] ? -1 : 1),
+                                "BitVector set")
+            }
+        }
+    }
+    set_simd_level(max_simd_level());
+
+#ifdef __cpp_lib_span
+    REPEAT(100)
+    {
+        size_t size = RandomUInt(0, 300);
+        std::vector<double> vec, vec2;
+        RandomFillDouble(vec, size);
+        RandomFillDouble(vec2, size);
+        std::vector<double> storage(2 * size);
+        std::span<double> first(storage.data(), size), second(storage.data() + size, size);
+
+        size_t before = allocation_count;
+        add(first, vec, vec2);
+        scale(second, vec, 2.);
+        assign(second, vec - vec2 + vec);
+        ASSERT_TRUE_MSG(allocation_count == before, "std::span allocations")
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_TRUE_MSG(first[i] == vec[i] + vec2[i], "add() into a std::span")
+            ASSERT_TRUE_MSG(fabs(second[i] - (2 * vec[i] - vec2[i])) < EPS, "assign() into a std::span")
+        }
+    }
+#endif
+
 }